@@ -1,8 +1,33 @@
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#elif defined(__linux__)
+#define _GNU_SOURCE
+#else
+#define _DEFAULT_SOURCE
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#include <io.h>
+#include <fcntl.h>
+#define getpid _getpid
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 typedef struct {
     size_t n;
@@ -62,10 +87,12 @@ static void big_mul10_add(Big* x, uint32_t digit) {
     }
 }
 
-static int big_from_dec(Big* x, const char* s) {
+static int big_from_dec_signed(Big* x, int* neg, const char* s) {
     big_zero(x);
+    *neg = 0;
     while (isspace((unsigned char)*s)) ++s;
     if (*s == '+') ++s;
+    else if (*s == '-') { *neg = 1; ++s; }
     if (!isdigit((unsigned char)*s)) return 0;
     for (; *s; ++s) {
         if (isspace((unsigned char)*s)) {
@@ -77,18 +104,208 @@ static int big_from_dec(Big* x, const char* s) {
     }
     if (*s != '\0') return 0;
     big_normalize(x);
-    if (x->n == 0) big_zero(x);
+    if (x->n == 0) { big_zero(x); *neg = 0; }
     return 1;
 }
 
-static void big_mul(Big* z, const Big* a, const Big* b) {
-    if ((a->n == 0) || (b->n == 0) ||
-        (a->n == 1 && a->d[0] == 0) ||
-        (b->n == 1 && b->d[0] == 0)) {
+static int big_from_dec(Big* x, const char* s) {
+    int neg;
+    return big_from_dec_signed(x, &neg, s) && !neg;
+}
+
+static size_t big_len(const Big* x) {
+    size_t n = x->n;
+    while (n > 0 && x->d[n - 1] == 0) --n;
+    return n;
+}
+
+static int big_is_zero(const Big* x) {
+    return big_len(x) == 0;
+}
+
+static int big_cmp(const Big* a, const Big* b) {
+    size_t an = big_len(a), bn = big_len(b);
+    if (an != bn) return an < bn ? -1 : 1;
+    for (size_t k = an; k-- > 0; ) {
+        if (a->d[k] != b->d[k]) return a->d[k] < b->d[k] ? -1 : 1;
+    }
+    return 0;
+}
+
+static void big_copy(Big* z, const Big* a) {
+    if (z == a) return;
+    if (a->n == 0) {
+        big_zero(z);
+        return;
+    }
+    big_reserve(z, a->n);
+    memcpy(z->d, a->d, a->n * sizeof(uint32_t));
+    z->n = a->n;
+}
+
+static void big_add(Big* z, const Big* a, const Big* b) {
+    if (big_len(a) < big_len(b)) { const Big* t = a; a = b; b = t; }
+    size_t an = big_len(a), bn = big_len(b);
+
+    big_reserve(z, an + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < bn; ++i) {
+        uint64_t t = (uint64_t)a->d[i] + b->d[i] + carry;
+        z->d[i] = (uint32_t)t;
+        carry = t >> 32;
+    }
+    for (size_t i = bn; i < an; ++i) {
+        uint64_t t = (uint64_t)a->d[i] + carry;
+        z->d[i] = (uint32_t)t;
+        carry = t >> 32;
+    }
+    z->d[an] = (uint32_t)carry;
+    z->n = an + 1;
+    big_normalize(z);
+    if (z->n == 0) big_zero(z);
+}
+
+/* z = a - b, requires a >= b. */
+static void big_sub(Big* z, const Big* a, const Big* b) {
+    size_t an = big_len(a), bn = big_len(b);
+
+    big_reserve(z, an ? an : 1);
+    uint32_t borrow = 0;
+    for (size_t i = 0; i < an; ++i) {
+        uint64_t bi = (i < bn ? b->d[i] : 0) + (uint64_t)borrow;
+        uint64_t ai = a->d[i];
+        z->d[i] = (uint32_t)(ai - bi);
+        borrow = ai < bi;
+    }
+    z->n = an;
+    big_normalize(z);
+    if (z->n == 0) big_zero(z);
+}
+
+static size_t big_count_nonzero(const Big* x) {
+    size_t nz = 0;
+    for (size_t i = 0; i < x->n; ++i) nz += (x->d[i] != 0);
+    return nz;
+}
+
+static void big_shl(Big* z, const Big* a, size_t limbs, unsigned bits) {
+    size_t rn = a->n + limbs + 1;
+
+    big_reserve(z, rn);
+    memset(z->d, 0, limbs * sizeof(uint32_t));
+    if (bits == 0) {
+        memcpy(z->d + limbs, a->d, a->n * sizeof(uint32_t));
+        z->d[rn - 1] = 0;
+    } else {
+        uint32_t carry = 0;
+        for (size_t i = 0; i < a->n; ++i) {
+            z->d[limbs + i] = (a->d[i] << bits) | carry;
+            carry = a->d[i] >> (32 - bits);
+        }
+        z->d[rn - 1] = carry;
+    }
+    z->n = rn;
+    big_normalize(z);
+    if (z->n == 0) big_zero(z);
+}
+
+static void big_shr(Big* z, const Big* a, size_t shift) {
+    size_t limbs = shift / 32;
+    unsigned bits = (unsigned)(shift % 32);
+    size_t an = big_len(a);
+    if (limbs >= an) {
         big_zero(z);
         return;
     }
 
+    size_t rn = an - limbs;
+    big_reserve(z, rn);
+    for (size_t i = 0; i < rn; ++i) {
+        uint32_t lo = a->d[limbs + i];
+        uint32_t hi = (i + 1 < rn) ? a->d[limbs + i + 1] : 0;
+        z->d[i] = bits ? (lo >> bits) | (hi << (32 - bits)) : lo;
+    }
+    z->n = rn;
+    big_normalize(z);
+    if (z->n == 0) big_zero(z);
+}
+
+static size_t big_bitlen(const Big* x) {
+    size_t n = big_len(x);
+    if (n == 0) return 0;
+    uint32_t top = x->d[n - 1];
+    size_t bits = 0;
+    while (top) { ++bits; top >>= 1; }
+    return (n - 1) * 32 + bits;
+}
+
+/* xxHash64-style mixing over 64-bit lanes of the limbs. */
+static uint64_t big_hash(const Big* x) {
+    const uint64_t p1 = 0x9E3779B185EBCA87ull, p2 = 0xC2B2AE3D27D4EB4Full;
+    const uint64_t p3 = 0x165667B19E3779F9ull;
+    size_t n = big_len(x);
+    uint64_t h = p3 + (uint64_t)n * p1;
+    size_t i = 0;
+    for (; i + 1 < n; i += 2) {
+        uint64_t v = x->d[i] | (uint64_t)x->d[i + 1] << 32;
+        v *= p2;
+        v = (v << 31) | (v >> 33);
+        h ^= v * p1;
+        h = ((h << 27) | (h >> 37)) * p1 + p2;
+    }
+    if (i < n) {
+        h ^= (uint64_t)x->d[i] * p1;
+        h = ((h << 23) | (h >> 41)) * p2 + p3;
+    }
+    h ^= h >> 33;
+    h *= p2;
+    h ^= h >> 29;
+    h *= p3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* Only the nonzero limbs of the sparse operand contribute a row. A single
+   power-of-two limb degenerates to a shift of the dense operand. */
+static void big_mul_sparse(Big* z, const Big* sp, const Big* dn) {
+    size_t sn = sp->n, bn = dn->n;
+    size_t rn = sn + bn;
+
+    if (big_count_nonzero(sp) == 1) {
+        uint32_t v = sp->d[sn - 1];
+        if ((v & (v - 1)) == 0) {
+            unsigned bits = 0;
+            while ((v >> bits) != 1) ++bits;
+            big_shl(z, dn, sn - 1, bits);
+            return;
+        }
+    }
+
+    big_reserve(z, rn);
+    memset(z->d, 0, rn * sizeof(uint32_t));
+    z->n = rn;
+
+    for (size_t i = 0; i < sn; ++i) {
+        uint64_t si = sp->d[i];
+        if (si == 0) continue;
+        uint64_t carry = 0;
+        for (size_t j = 0; j < bn; ++j) {
+            uint64_t sum = (uint64_t)z->d[i + j] + si * (uint64_t)dn->d[j] + carry;
+            z->d[i + j] = (uint32_t)sum;
+            carry = sum >> 32;
+        }
+        for (size_t k = i + bn; carry; ++k) {
+            uint64_t t = (uint64_t)z->d[k] + carry;
+            z->d[k] = (uint32_t)t;
+            carry = t >> 32;
+        }
+    }
+
+    big_normalize(z);
+    if (z->n == 0) big_zero(z);
+}
+
+static void big_mul_school(Big* z, const Big* a, const Big* b) {
     size_t an = a->n, bn = b->n;
     size_t rn = an + bn;
 
@@ -122,50 +339,5921 @@ static void big_mul(Big* z, const Big* a, const Big* b) {
     if (z->n == 0) big_zero(z);
 }
 
-static void big_print_hex(const Big* x) {
-    if (x->n == 0 || (x->n == 1 && x->d[0] == 0)) {
-        puts("0x0");
+/* Portable threads and locks. Global mutexes use BIG_MUTEX_INIT; threads
+   run a plain void (*)(void*) through a small trampoline. */
+#ifdef _WIN32
+typedef SRWLOCK BigMutex;
+#define BIG_MUTEX_INIT SRWLOCK_INIT
+typedef HANDLE BigThread;
+
+static void big_mutex_init(BigMutex* m) { InitializeSRWLock(m); }
+static void big_mutex_destroy(BigMutex* m) { (void)m; }
+static void big_mutex_lock(BigMutex* m) { AcquireSRWLockExclusive(m); }
+static void big_mutex_unlock(BigMutex* m) { ReleaseSRWLockExclusive(m); }
+
+typedef CONDITION_VARIABLE BigCond;
+
+static void big_cond_init(BigCond* c) { InitializeConditionVariable(c); }
+static void big_cond_destroy(BigCond* c) { (void)c; }
+static void big_cond_wait(BigCond* c, BigMutex* m) { SleepConditionVariableSRW(c, m, INFINITE, 0); }
+static void big_cond_broadcast(BigCond* c) { WakeAllConditionVariable(c); }
+#else
+typedef pthread_mutex_t BigMutex;
+#define BIG_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+typedef pthread_t BigThread;
+
+static void big_mutex_init(BigMutex* m) { pthread_mutex_init(m, NULL); }
+static void big_mutex_destroy(BigMutex* m) { pthread_mutex_destroy(m); }
+static void big_mutex_lock(BigMutex* m) { pthread_mutex_lock(m); }
+static void big_mutex_unlock(BigMutex* m) { pthread_mutex_unlock(m); }
+
+typedef pthread_cond_t BigCond;
+
+static void big_cond_init(BigCond* c) { pthread_cond_init(c, NULL); }
+static void big_cond_destroy(BigCond* c) { pthread_cond_destroy(c); }
+static void big_cond_wait(BigCond* c, BigMutex* m) { pthread_cond_wait(c, m); }
+static void big_cond_broadcast(BigCond* c) { pthread_cond_broadcast(c); }
+#endif
+
+typedef struct {
+    void (*fn)(void*);
+    void* arg;
+} BigThreadStart;
+
+#ifdef _WIN32
+static unsigned __stdcall big_thread_main(void* p) {
+#else
+static void* big_thread_main(void* p) {
+#endif
+    BigThreadStart s = *(BigThreadStart*)p;
+    free(p);
+    s.fn(s.arg);
+    return 0;
+}
+
+static void big_thread_start(BigThread* t, void (*fn)(void*), void* arg) {
+    BigThreadStart* s = (BigThreadStart*)malloc(sizeof(BigThreadStart));
+    if (!s) { perror("malloc"); exit(1); }
+    s->fn = fn;
+    s->arg = arg;
+#ifdef _WIN32
+    *t = (HANDLE)_beginthreadex(NULL, 0, big_thread_main, s, 0, NULL);
+    if (!*t) { perror("_beginthreadex"); exit(1); }
+#else
+    if (pthread_create(t, NULL, big_thread_main, s) != 0) {
+        fprintf(stderr, "pthread_create failed\n");
+        exit(1);
+    }
+#endif
+}
+
+static void big_thread_join(BigThread t) {
+#ifdef _WIN32
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+#else
+    pthread_join(t, NULL);
+#endif
+}
+
+static unsigned big_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors ? (unsigned)si.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned)n : 1;
+#endif
+}
+
+/* Worker placement (--affinity). Pool workers and shard processes take
+   slots in start order, and slot i runs on the i-th planned CPU (modulo
+   the plan). "cores" plans one logical CPU per physical core the process
+   may use, so no two workers are SMT siblings. "cache" plans the same
+   CPUs but lets each worker move among the CPUs sharing its last-level
+   cache. "isolated" plans one CPU per core among the CPUs the kernel
+   keeps free of other tasks (isolcpus). A list such as 0-3,8 plans
+   exactly those CPUs. Platforms without an affinity call run unpinned. */
+#define BIG_CPU_MAX 1024
+
+enum { AFFINITY_NONE, AFFINITY_CORES, AFFINITY_CACHE, AFFINITY_ISOLATED, AFFINITY_LIST };
+
+static struct {
+    int mode;
+    unsigned n;
+    unsigned short cpu[BIG_CPU_MAX];
+} big_affinity;
+
+/* Adds a CPU list such as "0-3,8" to mask; returns 0 on bad syntax. */
+static int big_cpu_list_parse(const char* s, unsigned char* mask) {
+    while (*s && *s != '\n') {
+        char* end;
+        unsigned long lo = strtoul(s, &end, 10), hi = lo;
+        if (end == s || !isdigit((unsigned char)*s)) return 0;
+        s = end;
+        if (*s == '-') {
+            hi = strtoul(s + 1, &end, 10);
+            if (end == s + 1 || !isdigit((unsigned char)s[1])) return 0;
+            s = end;
+        }
+        if (lo > hi || hi >= BIG_CPU_MAX) return 0;
+        for (unsigned long c = lo; c <= hi; ++c) mask[c] = 1;
+        if (*s == ',') ++s;
+        else if (*s && *s != '\n') return 0;
+    }
+    return 1;
+}
+
+#ifdef __linux__
+static int big_cpu_read_list(const char* path, unsigned char* mask) {
+    char buf[4096];
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    int ok = fgets(buf, sizeof(buf), f) != NULL && big_cpu_list_parse(buf, mask);
+    fclose(f);
+    return ok;
+}
+#endif
+
+/* Marks the CPUs this process may run on. */
+static void big_cpu_allowed(unsigned char* mask) {
+#ifdef _WIN32
+    DWORD_PTR pm, sm;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &pm, &sm)) {
+        for (unsigned c = 0; c < sizeof(pm) * 8; ++c) if ((pm >> c) & 1) mask[c] = 1;
+    }
+#elif defined(__linux__)
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (unsigned c = 0; c < BIG_CPU_MAX && c < CPU_SETSIZE; ++c) if (CPU_ISSET(c, &set)) mask[c] = 1;
+    }
+#else
+    for (unsigned c = 0; c < BIG_CPU_MAX && c < big_cpu_count(); ++c) mask[c] = 1;
+#endif
+}
+
+/* Marks the CPUs sharing a core (cache = 0) or the last-level cache
+   (cache = 1) with cpu, or just cpu when the topology is unknown. */
+static void big_cpu_group(unsigned cpu, int cache, unsigned char* mask) {
+    int found = 0;
+#ifdef _WIN32
+    DWORD len = 0;
+    GetLogicalProcessorInformation(NULL, &len);
+    SYSTEM_LOGICAL_PROCESSOR_INFORMATION* info = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION*)malloc(len ? len : 1);
+    if (!info) { perror("malloc"); exit(1); }
+    ULONG_PTR best = 0;
+    int level = 0;
+    if (cpu < sizeof(best) * 8 && GetLogicalProcessorInformation(info, &len)) {
+        for (DWORD i = 0; i < len / sizeof(*info); ++i) {
+            if (!((info[i].ProcessorMask >> cpu) & 1)) continue;
+            if (!cache && info[i].Relationship == RelationProcessorCore) best = info[i].ProcessorMask;
+            if (cache && info[i].Relationship == RelationCache && info[i].Cache.Level > level) {
+                best = info[i].ProcessorMask;
+                level = info[i].Cache.Level;
+            }
+        }
+    }
+    free(info);
+    for (unsigned c = 0; c < sizeof(best) * 8; ++c) {
+        if ((best >> c) & 1) {
+            mask[c] = 1;
+            found = 1;
+        }
+    }
+#elif defined(__linux__)
+    char path[128];
+    if (!cache) {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/thread_siblings_list", cpu);
+        found = big_cpu_read_list(path, mask);
+    } else {
+        int level = 0, best = -1;
+        for (int i = 0; i < 16; ++i) {
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%d/level", cpu, i);
+            FILE* f = fopen(path, "r");
+            if (!f) continue;
+            int l = 0;
+            if (fscanf(f, "%d", &l) == 1 && l > level) {
+                level = l;
+                best = i;
+            }
+            fclose(f);
+        }
+        if (best >= 0) {
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%d/shared_cpu_list", cpu, best);
+            found = big_cpu_read_list(path, mask);
+        }
+    }
+#else
+    (void)cache;
+#endif
+    if (!found) mask[cpu] = 1;
+}
+
+/* Plans the CPUs for an --affinity mode or CPU list; returns 0 if the
+   spec is invalid, names a CPU that does not exist or leaves no CPU. */
+static int big_affinity_plan(const char* spec) {
+    unsigned char use[BIG_CPU_MAX], taken[BIG_CPU_MAX];
+    memset(use, 0, sizeof(use));
+    memset(taken, 0, sizeof(taken));
+    int mode;
+    if (strcmp(spec, "cores") == 0) mode = AFFINITY_CORES;
+    else if (strcmp(spec, "cache") == 0) mode = AFFINITY_CACHE;
+    else if (strcmp(spec, "isolated") == 0) mode = AFFINITY_ISOLATED;
+    else mode = AFFINITY_LIST;
+
+    if (mode == AFFINITY_LIST) {
+        if (!big_cpu_list_parse(spec, use)) return 0;
+        for (unsigned c = big_cpu_count(); c < BIG_CPU_MAX; ++c) if (use[c]) return 0;
+    } else if (mode == AFFINITY_ISOLATED) {
+#ifdef __linux__
+        big_cpu_read_list("/sys/devices/system/cpu/isolated", use);
+#endif
+    } else {
+        big_cpu_allowed(use);
+    }
+    big_affinity.n = 0;
+    for (unsigned c = 0; c < BIG_CPU_MAX; ++c) {
+        if (!use[c] || taken[c]) continue;
+        big_affinity.cpu[big_affinity.n++] = (unsigned short)c;
+        if (mode != AFFINITY_LIST) big_cpu_group(c, 0, taken);
+    }
+    big_affinity.mode = mode;
+    return big_affinity.n != 0;
+}
+
+/* Marks the CPUs the worker in slot may run on and returns the planned
+   CPU, or returns -1 with no plan. May read sysfs, so a forked child must
+   have this done by its parent. */
+static int big_affinity_mask(unsigned slot, unsigned char* mask) {
+    memset(mask, 0, BIG_CPU_MAX);
+    if (!big_affinity.n) return -1;
+    unsigned cpu = big_affinity.cpu[slot % big_affinity.n];
+    if (big_affinity.mode == AFFINITY_CACHE) big_cpu_group(cpu, 1, mask);
+    else mask[cpu] = 1;
+    return (int)cpu;
+}
+
+/* Restricts the calling thread (or process) to mask; returns 0 on
+   failure. Only makes the affinity call, which is async-signal-safe, so
+   a child forked from a threaded process may use it. */
+static int big_affinity_set(const unsigned char* mask) {
+#ifdef _WIN32
+    DWORD_PTR m = 0;
+    for (unsigned c = 0; c < sizeof(m) * 8; ++c) if (mask[c]) m |= (DWORD_PTR)1 << c;
+    return m && SetThreadAffinityMask(GetCurrentThread(), m);
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned c = 0; c < BIG_CPU_MAX && c < CPU_SETSIZE; ++c) if (mask[c]) CPU_SET(c, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)mask;
+    return 1;
+#endif
+}
+
+/* Pins the calling thread to the CPU planned for slot. */
+static void big_affinity_pin(unsigned slot) {
+    unsigned char mask[BIG_CPU_MAX];
+    int cpu = big_affinity_mask(slot, mask);
+    if (cpu >= 0 && !big_affinity_set(mask)) fprintf(stderr, "Cannot pin a worker to CPU %d.\n", cpu);
+}
+
+/* Executor interface. Batch jobs, the task path's transform loops and
+   script levels all run through one, so an application embedding this
+   code can supply its own thread pool instead of a second private one.
+   submit queues fn(arg) to run once on some worker; `urgent` asks for it
+   to go ahead of loop slices and other queued tasks. parallel_for runs
+   fn(arg, 0 .. n - 1) on the caller and whichever workers are free, and
+   returns when every slice is done; it is called from inside tasks, so
+   the caller must be able to run all slices itself. idle (workers free
+   right now) and size (all workers) are hints for how finely to fork. */
+typedef struct {
+    void* ctx;
+    void (*submit)(void* ctx, void (*fn)(void*), void* arg, int urgent);
+    void (*parallel_for)(void* ctx, size_t n, void (*fn)(void*, size_t), void* arg);
+    unsigned (*idle)(void* ctx);
+    unsigned (*size)(void* ctx);
+} BigExecutor;
+
+/* Executor used by --batch and --script; NULL starts a built-in pool. An
+   embedding application sets it before calling run_batch or run_script. */
+static const BigExecutor* big_executor;
+
+/* With no executor, everything runs on the calling thread. */
+static void big_exec_for(const BigExecutor* ex, size_t n, void (*fn)(void*, size_t), void* arg) {
+    if (!ex || n < 2) {
+        for (size_t i = 0; i < n; ++i) fn(arg, i);
         return;
     }
-    printf("0x");
-    printf("%x", x->d[x->n - 1]);
-    for (size_t k = x->n - 1; k-- > 0; ) {
-        printf("%08x", x->d[k]);
+    ex->parallel_for(ex->ctx, n, fn, arg);
+}
+
+static unsigned big_exec_idle(const BigExecutor* ex) {
+    return ex ? ex->idle(ex->ctx) : 0;
+}
+
+static unsigned big_exec_size(const BigExecutor* ex) {
+    return ex ? ex->size(ex->ctx) : 0;
+}
+
+/* Built-in executor: a fixed set of threads serving submitted tasks and
+   slices of the parallel loops that running tasks post through
+   big_pool_for. Since only pool threads ever run work, a job's internal
+   parallelism and the parallelism between jobs share the same cores and
+   cannot oversubscribe them. A free worker takes an urgent task first,
+   then helps a posted loop, then takes any task. Loops therefore only
+   spread while no urgent task is waiting, and the owner of a loop runs
+   its slices itself whenever no one helps, so a loop never waits for a
+   worker to free up. */
+typedef struct BigPoolTask {
+    struct BigPoolTask* next;
+    void (*fn)(void*);
+    void* arg;
+} BigPoolTask;
+
+typedef struct BigParLoop {
+    struct BigParLoop* next;
+    void (*fn)(void* arg, size_t i);
+    void* arg;
+    size_t n, next_i, done;
+    unsigned helpers, max_helpers;
+} BigParLoop;
+
+typedef struct {
+    BigMutex lock;
+    BigCond wake;
+    BigCond loop_done;
+    unsigned size, idle, started;
+    int closed;
+    BigPoolTask* head[2];  /* normal, urgent */
+    BigPoolTask* tail[2];
+    BigParLoop* loops;
+    BigThread* threads;
+} BigPool;
+
+/* Called with the lock held. */
+static BigPoolTask* big_pool_take(BigPool* p, int urgent) {
+    for (int q = 1; q >= !urgent; --q) {
+        BigPoolTask* t = p->head[q];
+        if (!t) continue;
+        p->head[q] = t->next;
+        if (!t->next) p->tail[q] = NULL;
+        return t;
     }
-    puts("");
+    return NULL;
 }
 
-int main(void) {
-    char a_str[4096], b_str[4096];
+/* Called with the lock held. */
+static BigParLoop* big_pool_claim(BigPool* p, size_t* i) {
+    for (BigParLoop* l = p->loops; l; l = l->next) {
+        if (l->next_i < l->n && l->helpers < l->max_helpers) {
+            *i = l->next_i++;
+            ++l->helpers;
+            return l;
+        }
+    }
+    return NULL;
+}
 
-    printf("Enter first (decimal) number: ");
-    fflush(stdout);
-    if (!fgets(a_str, sizeof(a_str), stdin)) {
-        fprintf(stderr, "Input error.\n");
-        return 1;
+static void big_pool_worker(void* arg) {
+    BigPool* p = (BigPool*)arg;
+    big_mutex_lock(&p->lock);
+    unsigned slot = p->started++;
+    big_mutex_unlock(&p->lock);
+    big_affinity_pin(slot);
+    big_mutex_lock(&p->lock);
+    for (;;) {
+        BigPoolTask* job = big_pool_take(p, 1);
+        if (!job) {
+            size_t i;
+            BigParLoop* l = big_pool_claim(p, &i);
+            if (l) {
+                big_mutex_unlock(&p->lock);
+                l->fn(l->arg, i);
+                big_mutex_lock(&p->lock);
+                --l->helpers;
+                if (++l->done == l->n) big_cond_broadcast(&p->loop_done);
+                continue;
+            }
+            job = big_pool_take(p, 0);
+        }
+        if (job) {
+            big_mutex_unlock(&p->lock);
+            job->fn(job->arg);
+            free(job);
+            big_mutex_lock(&p->lock);
+            continue;
+        }
+        if (p->closed) break;
+        ++p->idle;
+        big_cond_wait(&p->wake, &p->lock);
+        --p->idle;
     }
+    big_mutex_unlock(&p->lock);
+}
 
-    printf("Enter second (decimal) number: ");
-    fflush(stdout);
-    if (!fgets(b_str, sizeof(b_str), stdin)) {
-        fprintf(stderr, "Input error.\n");
-        return 1;
+static void big_pool_start(BigPool* p, unsigned size) {
+    memset(p, 0, sizeof(*p));
+    big_mutex_init(&p->lock);
+    big_cond_init(&p->wake);
+    big_cond_init(&p->loop_done);
+    p->size = size ? size : 1;
+    p->threads = (BigThread*)malloc(p->size * sizeof(BigThread));
+    if (!p->threads) { perror("malloc"); exit(1); }
+    for (unsigned i = 0; i < p->size; ++i) big_thread_start(&p->threads[i], big_pool_worker, p);
+}
+
+static void big_pool_submit(BigPool* p, void (*fn)(void*), void* arg, int urgent) {
+    BigPoolTask* t = (BigPoolTask*)malloc(sizeof(BigPoolTask));
+    if (!t) { perror("malloc"); exit(1); }
+    t->next = NULL;
+    t->fn = fn;
+    t->arg = arg;
+    urgent = urgent != 0;
+    big_mutex_lock(&p->lock);
+    if (p->tail[urgent]) p->tail[urgent]->next = t;
+    else p->head[urgent] = t;
+    p->tail[urgent] = t;
+    big_cond_broadcast(&p->wake);
+    big_mutex_unlock(&p->lock);
+}
+
+/* Lets the workers run every queued task and exit, then joins them. */
+static void big_pool_stop(BigPool* p) {
+    big_mutex_lock(&p->lock);
+    p->closed = 1;
+    big_cond_broadcast(&p->wake);
+    big_mutex_unlock(&p->lock);
+    for (unsigned i = 0; i < p->size; ++i) big_thread_join(p->threads[i]);
+    free(p->threads);
+    big_cond_destroy(&p->wake);
+    big_cond_destroy(&p->loop_done);
+    big_mutex_destroy(&p->lock);
+}
+
+/* Runs fn(arg, 0 .. n - 1) on the caller plus up to n - 1 pool workers
+   that are free to help; returns once every slice is done. */
+static void big_pool_for(BigPool* p, size_t n, void (*fn)(void*, size_t), void* arg) {
+    BigParLoop l;
+    l.fn = fn;
+    l.arg = arg;
+    l.n = n;
+    l.next_i = 0;
+    l.done = 0;
+    l.helpers = 0;
+    l.max_helpers = (unsigned)(n - 1 < p->size ? n - 1 : p->size);
+    big_mutex_lock(&p->lock);
+    l.next = p->loops;
+    p->loops = &l;
+    if (p->idle) big_cond_broadcast(&p->wake);
+    while (l.next_i < n) {
+        size_t i = l.next_i++;
+        big_mutex_unlock(&p->lock);
+        fn(arg, i);
+        big_mutex_lock(&p->lock);
+        ++l.done;
     }
+    while (l.done < n) big_cond_wait(&p->loop_done, &p->lock);
+    BigParLoop** pp = &p->loops;
+    while (*pp != &l) pp = &(*pp)->next;
+    *pp = l.next;
+    big_mutex_unlock(&p->lock);
+}
 
-    Big A, B, C;
-    big_init(&A); big_init(&B); big_init(&C);
+static void big_pool_exec_submit(void* ctx, void (*fn)(void*), void* arg, int urgent) {
+    big_pool_submit((BigPool*)ctx, fn, arg, urgent);
+}
 
-    if (!big_from_dec(&A, a_str) || !big_from_dec(&B, b_str)) {
-        fprintf(stderr, "Invalid input. Please enter decimal digits only.\n");
-        big_free(&A); big_free(&B); big_free(&C);
-        return 1;
+static void big_pool_exec_for(void* ctx, size_t n, void (*fn)(void*, size_t), void* arg) {
+    big_pool_for((BigPool*)ctx, n, fn, arg);
+}
+
+static unsigned big_pool_exec_idle(void* ctx) {
+    BigPool* p = (BigPool*)ctx;
+    big_mutex_lock(&p->lock);
+    unsigned idle = p->idle;
+    big_mutex_unlock(&p->lock);
+    return idle;
+}
+
+static unsigned big_pool_exec_size(void* ctx) {
+    return ((BigPool*)ctx)->size;
+}
+
+static void big_pool_executor(BigExecutor* ex, BigPool* p) {
+    ex->ctx = p;
+    ex->submit = big_pool_exec_submit;
+    ex->parallel_for = big_pool_exec_for;
+    ex->idle = big_pool_exec_idle;
+    ex->size = big_pool_exec_size;
+}
+
+/* Guards the lazily grown NTT and FFT twiddle tables. */
+static BigMutex big_table_lock = BIG_MUTEX_INIT;
+
+/* Optional on-disk table cache. Each file is a 32-byte header followed by
+   uint32 payload words in native byte order; files are mapped read-only so
+   concurrent processes share them through the page cache. Writers go
+   through a temporary file and a rename, so readers never see a partial
+   table. The header carries a checksum of the payload, checked on every
+   load; a file with an unexpected header, size or checksum is ignored and
+   the table is rebuilt and stored again. */
+#define BIG_CACHE_MAGIC "BIGNUMTB"
+#define BIG_CACHE_VERSION 2u
+#define BIG_CACHE_NTT 1u
+#define BIG_CACHE_POW10 2u
+#define BIG_CACHE_COST 3u
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;
+    uint32_t param;
+    uint32_t sum;
+    uint64_t words;
+} BigCacheHeader;
+
+static const char* big_cache_dir;
+
+static void big_cache_path(char* buf, size_t size, uint32_t kind, uint32_t param) {
+    snprintf(buf, size, "%s/%s-%lu.tab", big_cache_dir,
+        kind == BIG_CACHE_NTT ? "ntt" : kind == BIG_CACHE_POW10 ? "pow10" : "cost", (unsigned long)param);
+}
+
+/* Folds n payload words into a running checksum, one word at a time so a
+   table written in parts sums the same as one read back whole; start from
+   BIG_CACHE_SEED and finish with big_cache_sum. */
+#define BIG_CACHE_SEED 0x165667B19E3779F9ull
+
+static uint64_t big_cache_mix(uint64_t h, const uint32_t* w, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        h ^= (uint64_t)w[i] * 0xC2B2AE3D27D4EB4Full;
+        h = ((h << 31) | (h >> 33)) * 0x9E3779B185EBCA87ull;
     }
+    return h;
+}
 
-    big_mul(&C, &A, &B);
+static uint32_t big_cache_sum(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xC2B2AE3D27D4EB4Full;
+    h ^= h >> 29;
+    return (uint32_t)(h ^ (h >> 32));
+}
 
-    printf("Result (hex): ");
-    big_print_hex(&C);
+/* Maps a whole file read-only; the mapping lives until exit. */
+static const unsigned char* big_cache_map(const char* path, size_t* size) {
+#ifdef _WIN32
+    HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (f == INVALID_HANDLE_VALUE) return NULL;
+    LARGE_INTEGER len;
+    const unsigned char* p = NULL;
+    if (GetFileSizeEx(f, &len) && len.QuadPart > 0) {
+        HANDLE m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m) {
+            p = (const unsigned char*)MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(m);
+        }
+        *size = (size_t)len.QuadPart;
+    }
+    CloseHandle(f);
+    return p;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    const unsigned char* p = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (m != MAP_FAILED) p = (const unsigned char*)m;
+        *size = (size_t)st.st_size;
+    }
+    close(fd);
+    return p;
+#endif
+}
+
+/* Returns the payload of a cached table, or NULL if there is none or it
+   fails its checksum. */
+static const uint32_t* big_cache_load(uint32_t kind, uint32_t param, uint64_t* words) {
+    if (!big_cache_dir || !*big_cache_dir) return NULL;
+    char path[1024];
+    big_cache_path(path, sizeof(path), kind, param);
+    size_t size = 0;
+    const unsigned char* p = big_cache_map(path, &size);
+    if (!p) return NULL;
+
+    BigCacheHeader h;
+    if (size < sizeof(h)) return NULL;
+    memcpy(&h, p, sizeof(h));
+    if (memcmp(h.magic, BIG_CACHE_MAGIC, 8) != 0 || h.version != BIG_CACHE_VERSION ||
+        h.kind != kind || h.param != param || h.words != (size - sizeof(h)) / 4 ||
+        (size - sizeof(h)) % 4 != 0) {
+        return NULL;
+    }
+    const uint32_t* w = (const uint32_t*)(p + sizeof(h));
+    if (big_cache_sum(big_cache_mix(BIG_CACHE_SEED, w, (size_t)h.words)) != h.sum) return NULL;
+    *words = h.words;
+    return w;
+}
+
+/* Writes the concatenation of `parts` arrays of `words` words each. */
+static void big_cache_store(uint32_t kind, uint32_t param, const uint32_t* const* arrs,
+                            int parts, size_t words) {
+    if (!big_cache_dir || !*big_cache_dir) return;
+    char path[1024], tmp[1100];
+    big_cache_path(path, sizeof(path), kind, param);
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+
+    BigCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, BIG_CACHE_MAGIC, 8);
+    h.version = BIG_CACHE_VERSION;
+    h.kind = kind;
+    h.param = param;
+    h.words = (uint64_t)parts * words;
+    uint64_t sum = BIG_CACHE_SEED;
+    for (int i = 0; i < parts; ++i) sum = big_cache_mix(sum, arrs[i], words);
+    h.sum = big_cache_sum(sum);
+
+    FILE* f = fopen(tmp, "wb");
+    if (!f) return;
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (int i = 0; ok && i < parts; ++i) {
+        ok = fwrite(arrs[i], sizeof(uint32_t), words, f) == words;
+    }
+    if (fclose(f) != 0) ok = 0;
+    if (ok && rename(tmp, path) != 0) {
+        remove(path);
+        ok = rename(tmp, path) == 0;
+    }
+    if (!ok) remove(tmp);
+}
+
+/* Number-theoretic transform tier. The three primes are below 2^30 and
+   each has 3 * 2^22-th roots of unity, so transform lengths may be 2^k or
+   3 * 2^k and padding stays under 1.5x. Their product (~2^89) bounds the
+   convolution coefficients of up to 2^25 limb pairs. */
+#define NTT_MAX_LOG2 22
+#define NTT_MAX_LEN ((size_t)3 << NTT_MAX_LOG2)
+#define BIG_NTT_THRESHOLD 256
+
+static const uint32_t ntt_mod[3] = { 880803841u, 754974721u, 943718401u };
+static const uint32_t ntt_gen[3] = { 26u, 11u, 7u };
+
+typedef struct {
+    uint32_t* w;
+    uint32_t* ws;
+    uint32_t* iw;
+    uint32_t* iws;
+    size_t len;
+} NttTable;
+
+/* Published tables are immutable. Growing one builds a larger copy, so a
+   transform still holding the old table keeps a valid one; superseded
+   tables are never freed. */
+static const NttTable* ntt_tab[3];
+
+static uint32_t ntt_mulmod(uint32_t a, uint32_t b, uint32_t p) {
+    return (uint32_t)((uint64_t)a * b % p);
+}
+
+static uint32_t ntt_pow(uint32_t a, uint64_t e, uint32_t p) {
+    uint32_t r = 1;
+    for (; e; e >>= 1) {
+        if (e & 1) r = ntt_mulmod(r, a, p);
+        a = ntt_mulmod(a, a, p);
+    }
+    return r;
+}
+
+/* Shoup companion of a fixed multiplier: floor(w * 2^32 / p). */
+static uint32_t ntt_shoup_pre(uint32_t w, uint32_t p) {
+    return (uint32_t)(((uint64_t)w << 32) / p);
+}
+
+/* x * w mod p, lazily reduced to [0, 2p), for any 32-bit x. */
+static uint32_t ntt_shoup(uint32_t x, uint32_t w, uint32_t ws, uint32_t p) {
+    uint32_t q = (uint32_t)(((uint64_t)x * ws) >> 32);
+    return x * w - q * p;
+}
+
+/* p^-1 mod 2^32 by Newton iteration; p odd is already correct to 3 bits. */
+static uint32_t ntt_pinv(uint32_t p) {
+    uint32_t x = p;
+    for (int i = 0; i < 4; ++i) x *= 2 - p * x;
+    return x;
+}
+
+/* Montgomery product a * b * 2^-32 mod p in [0, p); needs a * b < p * 2^32. */
+static uint32_t ntt_mont(uint32_t a, uint32_t b, uint32_t p, uint32_t pinv) {
+    uint64_t t = (uint64_t)a * b;
+    uint32_t m = (uint32_t)t * pinv;
+    uint32_t u = (uint32_t)(t >> 32) - (uint32_t)(((uint64_t)m * p) >> 32);
+    return u < p ? u : u + p;
+}
+
+/* Per level h (a power of two below len): w[h - 1 + j] = w_{2h}^j and
+   iw[h - 1 + j] = w_{2h}^-j, each with its Shoup companion. */
+static const NttTable* ntt_grow(int k, const NttTable* old, size_t len) {
+    uint32_t p = ntt_mod[k];
+    NttTable* t = (NttTable*)malloc(sizeof(NttTable));
+    uint32_t* buf = (uint32_t*)malloc(4 * len * sizeof(uint32_t));
+    if (!t || !buf) { perror("malloc"); exit(1); }
+    t->w = buf;
+    t->ws = buf + len;
+    t->iw = buf + 2 * len;
+    t->iws = buf + 3 * len;
+    t->len = len;
+
+    size_t have = old ? old->len : 0;
+    if (have) {
+        memcpy(t->w, old->w, have * sizeof(uint32_t));
+        memcpy(t->ws, old->ws, have * sizeof(uint32_t));
+        memcpy(t->iw, old->iw, have * sizeof(uint32_t));
+        memcpy(t->iws, old->iws, have * sizeof(uint32_t));
+    }
+    for (size_t h = have ? have : 1; h < len; h <<= 1) {
+        uint32_t wl = ntt_pow(ntt_gen[k], (p - 1) / (2 * h), p);
+        uint32_t il = ntt_pow(wl, p - 2, p);
+        uint32_t* w = t->w + h - 1;
+        uint32_t* iw = t->iw + h - 1;
+        w[0] = iw[0] = 1;
+        for (size_t j = 1; j < h; ++j) {
+            w[j] = ntt_mulmod(w[j - 1], wl, p);
+            iw[j] = ntt_mulmod(iw[j - 1], il, p);
+        }
+        for (size_t j = 0; j < h; ++j) {
+            t->ws[h - 1 + j] = ntt_shoup_pre(w[j], p);
+            t->iws[h - 1 + j] = ntt_shoup_pre(iw[j], p);
+        }
+    }
+    const uint32_t* const out[4] = { t->w, t->ws, t->iw, t->iws };
+    big_cache_store(BIG_CACHE_NTT, p, out, 4, len);
+    return t;
+}
+
+/* A cached table maps straight into the file's read-only pages. */
+static const NttTable* ntt_load(int k) {
+    uint64_t words;
+    const uint32_t* c = big_cache_load(BIG_CACHE_NTT, ntt_mod[k], &words);
+    if (!c || words % 4 != 0) return NULL;
+    NttTable* t = (NttTable*)malloc(sizeof(NttTable));
+    if (!t) { perror("malloc"); exit(1); }
+    size_t len = (size_t)(words / 4);
+    t->w = (uint32_t*)c;
+    t->ws = (uint32_t*)c + len;
+    t->iw = (uint32_t*)c + 2 * len;
+    t->iws = (uint32_t*)c + 3 * len;
+    t->len = len;
+    return t;
+}
+
+static const NttTable* ntt_twiddles(int k, size_t len) {
+    big_mutex_lock(&big_table_lock);
+    const NttTable* t = ntt_tab[k];
+    if (!t) t = ntt_tab[k] = ntt_load(k);
+    if (!t || t->len < len) t = ntt_tab[k] = ntt_grow(k, t, len);
+    big_mutex_unlock(&big_table_lock);
+    return t;
+}
+
+/* Harvey butterflies. DIF keeps values in [0, 2p); DIT accepts and
+   produces [0, 4p). All three primes are below 2^30 so 4p fits in 32 bits. */
+static void ntt_bf_dif(uint32_t* x, uint32_t* y, uint32_t w, uint32_t ws, uint32_t p) {
+    uint32_t u = *x, v = *y, p2 = 2 * p;
+    uint32_t s = u + v;
+    *x = s >= p2 ? s - p2 : s;
+    *y = ntt_shoup(u - v + p2, w, ws, p);
+}
+
+static void ntt_bf_dit(uint32_t* x, uint32_t* y, uint32_t w, uint32_t ws, uint32_t p) {
+    uint32_t p2 = 2 * p;
+    uint32_t u = *x >= p2 ? *x - p2 : *x;
+    uint32_t t = ntt_shoup(*y, w, ws, p);
+    *x = u + t;
+    *y = u - t + p2;
+}
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX512F__)
+#define NTT_LANES 16
+typedef __m512i NttVec;
+static NttVec ntt_vload(const uint32_t* s) { return _mm512_loadu_si512((const void*)s); }
+static void ntt_vstore(uint32_t* d, NttVec v) { _mm512_storeu_si512((void*)d, v); }
+static NttVec ntt_vset(uint32_t x) { return _mm512_set1_epi32((int)x); }
+static NttVec ntt_vadd(NttVec a, NttVec b) { return _mm512_add_epi32(a, b); }
+static NttVec ntt_vsub(NttVec a, NttVec b) { return _mm512_sub_epi32(a, b); }
+static NttVec ntt_vmin(NttVec a, NttVec b) { return _mm512_min_epu32(a, b); }
+static NttVec ntt_vmullo(NttVec a, NttVec b) { return _mm512_mullo_epi32(a, b); }
+static NttVec ntt_vmulhi(NttVec a, NttVec b) {
+    NttVec e = _mm512_srli_epi64(_mm512_mul_epu32(a, b), 32);
+    NttVec o = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), _mm512_srli_epi64(b, 32));
+    return _mm512_mask_blend_epi32(0xAAAA, e, o);
+}
+#elif defined(__AVX2__)
+#define NTT_LANES 8
+typedef __m256i NttVec;
+static NttVec ntt_vload(const uint32_t* s) { return _mm256_loadu_si256((const __m256i*)s); }
+static void ntt_vstore(uint32_t* d, NttVec v) { _mm256_storeu_si256((__m256i*)d, v); }
+static NttVec ntt_vset(uint32_t x) { return _mm256_set1_epi32((int)x); }
+static NttVec ntt_vadd(NttVec a, NttVec b) { return _mm256_add_epi32(a, b); }
+static NttVec ntt_vsub(NttVec a, NttVec b) { return _mm256_sub_epi32(a, b); }
+static NttVec ntt_vmin(NttVec a, NttVec b) { return _mm256_min_epu32(a, b); }
+static NttVec ntt_vmullo(NttVec a, NttVec b) { return _mm256_mullo_epi32(a, b); }
+static NttVec ntt_vmulhi(NttVec a, NttVec b) {
+    NttVec e = _mm256_srli_epi64(_mm256_mul_epu32(a, b), 32);
+    NttVec o = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+    return _mm256_blend_epi32(e, o, 0xAA);
+}
+#endif
+
+#ifdef NTT_LANES
+static NttVec ntt_vshoup(NttVec x, NttVec w, NttVec ws, NttVec p) {
+    return ntt_vsub(ntt_vmullo(x, w), ntt_vmullo(ntt_vmulhi(x, ws), p));
+}
+
+static NttVec ntt_vmont(NttVec a, NttVec b, NttVec p, NttVec pinv) {
+    NttVec m = ntt_vmullo(ntt_vmullo(a, b), pinv);
+    NttVec u = ntt_vsub(ntt_vmulhi(a, b), ntt_vmulhi(m, p));
+    return ntt_vmin(u, ntt_vadd(u, p));
+}
+
+static void ntt_vbf_dif(NttVec* x, NttVec* y, NttVec w, NttVec ws, NttVec p, NttVec p2) {
+    NttVec s = ntt_vadd(*x, *y);
+    NttVec d = ntt_vsub(ntt_vadd(*x, p2), *y);
+    *x = ntt_vmin(s, ntt_vsub(s, p2));
+    *y = ntt_vshoup(d, w, ws, p);
+}
+
+static void ntt_vbf_dit(NttVec* x, NttVec* y, NttVec w, NttVec ws, NttVec p, NttVec p2) {
+    NttVec u = ntt_vmin(*x, ntt_vsub(*x, p2));
+    NttVec t = ntt_vshoup(*y, w, ws, p);
+    *x = ntt_vadd(u, t);
+    *y = ntt_vsub(ntt_vadd(u, p2), t);
+}
+#endif
+
+/* Decimation in frequency, natural order in, bit-reversed order out. Two
+   radix-2 levels are fused per pass (a radix-4 step) to halve the sweeps
+   over memory. */
+static void ntt_dif(uint32_t* a, size_t m, const NttTable* t, uint32_t p) {
+    size_t h = m >> 1;
+    for (; h >= 2; h >>= 2) {
+        size_t q = h >> 1;
+        const uint32_t* w1 = t->w + h - 1;
+        const uint32_t* s1 = t->ws + h - 1;
+        const uint32_t* w2 = t->w + q - 1;
+        const uint32_t* s2 = t->ws + q - 1;
+        for (size_t i = 0; i < m; i += 2 * h) {
+            uint32_t* x = a + i;
+            size_t j = 0;
+#ifdef NTT_LANES
+            NttVec vp = ntt_vset(p), vp2 = ntt_vset(2 * p);
+            for (; j + NTT_LANES <= q; j += NTT_LANES) {
+                NttVec x0 = ntt_vload(x + j), x1 = ntt_vload(x + j + q);
+                NttVec x2 = ntt_vload(x + j + h), x3 = ntt_vload(x + j + h + q);
+                NttVec v2 = ntt_vload(w2 + j), vs2 = ntt_vload(s2 + j);
+                ntt_vbf_dif(&x0, &x2, ntt_vload(w1 + j), ntt_vload(s1 + j), vp, vp2);
+                ntt_vbf_dif(&x1, &x3, ntt_vload(w1 + j + q), ntt_vload(s1 + j + q), vp, vp2);
+                ntt_vbf_dif(&x0, &x1, v2, vs2, vp, vp2);
+                ntt_vbf_dif(&x2, &x3, v2, vs2, vp, vp2);
+                ntt_vstore(x + j, x0); ntt_vstore(x + j + q, x1);
+                ntt_vstore(x + j + h, x2); ntt_vstore(x + j + h + q, x3);
+            }
+#endif
+            for (; j < q; ++j) {
+                ntt_bf_dif(x + j, x + j + h, w1[j], s1[j], p);
+                ntt_bf_dif(x + j + q, x + j + h + q, w1[j + q], s1[j + q], p);
+                ntt_bf_dif(x + j, x + j + q, w2[j], s2[j], p);
+                ntt_bf_dif(x + j + h, x + j + h + q, w2[j], s2[j], p);
+            }
+        }
+    }
+    if (h == 1) {
+        for (size_t i = 0; i < m; i += 2) ntt_bf_dif(a + i, a + i + 1, t->w[0], t->ws[0], p);
+    }
+}
+
+/* Exact inverse of ntt_dif up to a factor of m, fusing levels the same way. */
+static void ntt_dit_inv(uint32_t* a, size_t m, const NttTable* t, uint32_t p) {
+    size_t h = 1;
+    for (; 2 * h < m; h <<= 2) {
+        const uint32_t* w1 = t->iw + h - 1;
+        const uint32_t* s1 = t->iws + h - 1;
+        const uint32_t* w2 = t->iw + 2 * h - 1;
+        const uint32_t* s2 = t->iws + 2 * h - 1;
+        for (size_t i = 0; i < m; i += 4 * h) {
+            uint32_t* x = a + i;
+            size_t j = 0;
+#ifdef NTT_LANES
+            NttVec vp = ntt_vset(p), vp2 = ntt_vset(2 * p);
+            for (; j + NTT_LANES <= h; j += NTT_LANES) {
+                NttVec x0 = ntt_vload(x + j), x1 = ntt_vload(x + j + h);
+                NttVec x2 = ntt_vload(x + j + 2 * h), x3 = ntt_vload(x + j + 3 * h);
+                NttVec v1 = ntt_vload(w1 + j), vs1 = ntt_vload(s1 + j);
+                ntt_vbf_dit(&x0, &x1, v1, vs1, vp, vp2);
+                ntt_vbf_dit(&x2, &x3, v1, vs1, vp, vp2);
+                ntt_vbf_dit(&x0, &x2, ntt_vload(w2 + j), ntt_vload(s2 + j), vp, vp2);
+                ntt_vbf_dit(&x1, &x3, ntt_vload(w2 + j + h), ntt_vload(s2 + j + h), vp, vp2);
+                ntt_vstore(x + j, x0); ntt_vstore(x + j + h, x1);
+                ntt_vstore(x + j + 2 * h, x2); ntt_vstore(x + j + 3 * h, x3);
+            }
+#endif
+            for (; j < h; ++j) {
+                ntt_bf_dit(x + j, x + j + h, w1[j], s1[j], p);
+                ntt_bf_dit(x + j + 2 * h, x + j + 3 * h, w1[j], s1[j], p);
+                ntt_bf_dit(x + j, x + j + 2 * h, w2[j], s2[j], p);
+                ntt_bf_dit(x + j + h, x + j + 3 * h, w2[j + h], s2[j + h], p);
+            }
+        }
+    }
+    if (h < m) {
+        const uint32_t* w = t->iw + h - 1;
+        const uint32_t* s = t->iws + h - 1;
+        size_t j = 0;
+#ifdef NTT_LANES
+        NttVec vp = ntt_vset(p), vp2 = ntt_vset(2 * p);
+        for (; j + NTT_LANES <= h; j += NTT_LANES) {
+            NttVec x0 = ntt_vload(a + j), x1 = ntt_vload(a + j + h);
+            ntt_vbf_dit(&x0, &x1, ntt_vload(w + j), ntt_vload(s + j), vp, vp2);
+            ntt_vstore(a + j, x0); ntt_vstore(a + j + h, x1);
+        }
+#endif
+        for (; j < h; ++j) ntt_bf_dit(a + j, a + j + h, w[j], s[j], p);
+    }
+}
+
+/* a[i] = a[i] * b[i] * 2^-32 mod p; inputs below 2p, outputs below p. */
+static void ntt_pointwise(uint32_t* a, const uint32_t* b, size_t n, int k) {
+    uint32_t p = ntt_mod[k], pinv = ntt_pinv(p);
+    size_t i = 0;
+#ifdef NTT_LANES
+    NttVec vp = ntt_vset(p), vpinv = ntt_vset(pinv);
+    for (; i + NTT_LANES <= n; i += NTT_LANES) {
+        ntt_vstore(a + i, ntt_vmont(ntt_vload(a + i), ntt_vload(b + i), vp, vpinv));
+    }
+#endif
+    for (; i < n; ++i) a[i] = ntt_mont(a[i], b[i], p, pinv);
+}
+
+/* a[i] = a[i] * c mod p in [0, p) for a fixed c; any 32-bit input. */
+static void ntt_scale(uint32_t* a, size_t n, uint32_t c, uint32_t p) {
+    uint32_t cs = ntt_shoup_pre(c, p);
+    size_t i = 0;
+#ifdef NTT_LANES
+    NttVec vp = ntt_vset(p), vc = ntt_vset(c), vcs = ntt_vset(cs);
+    for (; i + NTT_LANES <= n; i += NTT_LANES) {
+        NttVec x = ntt_vshoup(ntt_vload(a + i), vc, vcs, vp);
+        ntt_vstore(a + i, ntt_vmin(x, ntt_vsub(x, vp)));
+    }
+#endif
+    for (; i < n; ++i) {
+        uint32_t x = ntt_shoup(a[i], c, cs, p);
+        a[i] = x >= p ? x - p : x;
+    }
+}
+
+/* Cache-oblivious transpose of a rows x cols block: dst[j][i] = src[i][j]. */
+static void ntt_transpose(uint32_t* dst, size_t dst_stride, const uint32_t* src, size_t src_stride,
+                          size_t rows, size_t cols) {
+    if (rows <= 16 && cols <= 16) {
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) dst[j * dst_stride + i] = src[i * src_stride + j];
+        }
+    } else if (rows >= cols) {
+        size_t h = rows / 2;
+        ntt_transpose(dst, dst_stride, src, src_stride, h, cols);
+        ntt_transpose(dst + h, dst_stride, src + h * src_stride, src_stride, rows - h, cols);
+    } else {
+        size_t h = cols / 2;
+        ntt_transpose(dst, dst_stride, src, src_stride, rows, h);
+        ntt_transpose(dst + h * dst_stride, dst_stride, src + h, src_stride, rows, cols - h);
+    }
+}
+
+/* Row i of the rows x len matrix holds the R-point outputs whose natural
+   index is k = bitrev(i), and is multiplied by w^(k * j) along j. That is
+   a geometric sequence along each row, stepped in Montgomery form. Only
+   rows [i0, i1) are touched. */
+static void ntt_twiddle_rows(uint32_t* a, size_t rows, size_t i0, size_t i1, size_t len,
+                             uint32_t w, uint32_t p) {
+    unsigned lg = 0;
+    while (((size_t)1 << lg) < rows) ++lg;
+    uint32_t pinv = ntt_pinv(p);
+    uint32_t r32 = (uint32_t)(((uint64_t)1 << 32) % p);
+
+    for (size_t i = i0 ? i0 : 1; i < i1; ++i) {
+        size_t k = 0;
+        for (unsigned b = 0; b < lg; ++b) k |= ((i >> b) & 1) << (lg - 1 - b);
+        uint32_t base = ntt_mulmod(ntt_pow(w, k, p), r32, p);
+        uint32_t* row = a + i * len;
+        uint32_t t = r32;
+        size_t j = 0;
+#ifdef NTT_LANES
+        uint32_t lanes[NTT_LANES];
+        for (int l = 0; l < NTT_LANES; ++l) {
+            lanes[l] = t;
+            t = ntt_mont(t, base, p, pinv);
+        }
+        NttVec vp = ntt_vset(p), vpinv = ntt_vset(pinv);
+        NttVec vstep = ntt_vset(t), vt = ntt_vload(lanes);
+        for (; j + NTT_LANES <= len; j += NTT_LANES) {
+            ntt_vstore(row + j, ntt_vmont(ntt_vload(row + j), vt, vp, vpinv));
+            vt = ntt_vmont(vt, vstep, vp, vpinv);
+        }
+        ntt_vstore(lanes, vt);
+        t = lanes[0];
+#endif
+        for (; j < len; ++j) {
+            row[j] = ntt_mont(row[j], t, p, pinv);
+            t = ntt_mont(t, base, p, pinv);
+        }
+    }
+}
+
+/* Transforms down the columns of a rows x cols block stored contiguously,
+   with the same fused radix-4 passes as ntt_dif and ntt_dit_inv. Every
+   butterfly pairs whole row segments under one twiddle, so the inner
+   loops run along the rows. */
+static void ntt_dif_seg(uint32_t* x, uint32_t* y, size_t cols, uint32_t w, uint32_t ws, uint32_t p) {
+    size_t c = 0;
+#ifdef NTT_LANES
+    NttVec vp = ntt_vset(p), vp2 = ntt_vset(2 * p), vw = ntt_vset(w), vs = ntt_vset(ws);
+    for (; c + NTT_LANES <= cols; c += NTT_LANES) {
+        NttVec x0 = ntt_vload(x + c), y0 = ntt_vload(y + c);
+        ntt_vbf_dif(&x0, &y0, vw, vs, vp, vp2);
+        ntt_vstore(x + c, x0); ntt_vstore(y + c, y0);
+    }
+#endif
+    for (; c < cols; ++c) ntt_bf_dif(x + c, y + c, w, ws, p);
+}
+
+static void ntt_dit_seg(uint32_t* x, uint32_t* y, size_t cols, uint32_t w, uint32_t ws, uint32_t p) {
+    size_t c = 0;
+#ifdef NTT_LANES
+    NttVec vp = ntt_vset(p), vp2 = ntt_vset(2 * p), vw = ntt_vset(w), vs = ntt_vset(ws);
+    for (; c + NTT_LANES <= cols; c += NTT_LANES) {
+        NttVec x0 = ntt_vload(x + c), y0 = ntt_vload(y + c);
+        ntt_vbf_dit(&x0, &y0, vw, vs, vp, vp2);
+        ntt_vstore(x + c, x0); ntt_vstore(y + c, y0);
+    }
+#endif
+    for (; c < cols; ++c) ntt_bf_dit(x + c, y + c, w, ws, p);
+}
+
+static void ntt_dif_cols(uint32_t* a, size_t rows, size_t cols, const NttTable* t, uint32_t p) {
+    size_t h = rows >> 1;
+    for (; h >= 2; h >>= 2) {
+        size_t q = h >> 1;
+        const uint32_t* w1 = t->w + h - 1;
+        const uint32_t* s1 = t->ws + h - 1;
+        const uint32_t* w2 = t->w + q - 1;
+        const uint32_t* s2 = t->ws + q - 1;
+        for (size_t i = 0; i < rows; i += 2 * h) {
+            for (size_t j = 0; j < q; ++j) {
+                uint32_t* x0 = a + (i + j) * cols;
+                uint32_t* x1 = x0 + q * cols;
+                uint32_t* x2 = x0 + h * cols;
+                uint32_t* x3 = x2 + q * cols;
+                ntt_dif_seg(x0, x2, cols, w1[j], s1[j], p);
+                ntt_dif_seg(x1, x3, cols, w1[j + q], s1[j + q], p);
+                ntt_dif_seg(x0, x1, cols, w2[j], s2[j], p);
+                ntt_dif_seg(x2, x3, cols, w2[j], s2[j], p);
+            }
+        }
+    }
+    if (h == 1) {
+        for (size_t i = 0; i < rows; i += 2) ntt_dif_seg(a + i * cols, a + (i + 1) * cols, cols, t->w[0], t->ws[0], p);
+    }
+}
+
+static void ntt_dit_inv_cols(uint32_t* a, size_t rows, size_t cols, const NttTable* t, uint32_t p) {
+    size_t h = 1;
+    for (; 2 * h < rows; h <<= 2) {
+        const uint32_t* w1 = t->iw + h - 1;
+        const uint32_t* s1 = t->iws + h - 1;
+        const uint32_t* w2 = t->iw + 2 * h - 1;
+        const uint32_t* s2 = t->iws + 2 * h - 1;
+        for (size_t i = 0; i < rows; i += 4 * h) {
+            for (size_t j = 0; j < h; ++j) {
+                uint32_t* x0 = a + (i + j) * cols;
+                uint32_t* x1 = x0 + h * cols;
+                uint32_t* x2 = x1 + h * cols;
+                uint32_t* x3 = x2 + h * cols;
+                ntt_dit_seg(x0, x1, cols, w1[j], s1[j], p);
+                ntt_dit_seg(x2, x3, cols, w1[j], s1[j], p);
+                ntt_dit_seg(x0, x2, cols, w2[j], s2[j], p);
+                ntt_dit_seg(x1, x3, cols, w2[j + h], s2[j + h], p);
+            }
+        }
+    }
+    if (h < rows) {
+        for (size_t j = 0; j < h; ++j) {
+            ntt_dit_seg(a + j * cols, a + (j + h) * cols, cols, t->iw[h - 1 + j], t->iws[h - 1 + j], p);
+        }
+    }
+}
+
+/* Copies columns [j, j + cols) of a rows x stride matrix into or out of a
+   contiguous rows x cols block. */
+static void ntt_cols_load(uint32_t* blk, const uint32_t* a, size_t rows, size_t stride, size_t cols) {
+    for (size_t i = 0; i < rows; ++i) memcpy(blk + i * cols, a + i * stride, cols * sizeof(uint32_t));
+}
+
+static void ntt_cols_store(uint32_t* a, const uint32_t* blk, size_t rows, size_t stride, size_t cols) {
+    for (size_t i = 0; i < rows; ++i) memcpy(a + i * stride, blk + i * cols, cols * sizeof(uint32_t));
+}
+
+/* Six-step (Bailey) layout for transforms that outgrow the cache: view the
+   input as an R x C matrix with rows of NTT_ROW_WORDS, run R-point
+   transforms down the columns, twiddle, and run C-point transforms along
+   the rows. Nothing is transposed. The columns are done NTT_COL_WORDS
+   words at a time, copied into a contiguous block that stays in cache
+   (the power-of-two row stride would map every row to the same cache
+   sets) and twiddled there; each row fits in L1. The output is left in
+   R x C order with both indices bit reversed; only ntt_sixstep_inv reads
+   it, and pointwise products do not care about order. Against the flat
+   transform it was about 10% faster at 2^22 points and level at 2^20 and
+   2^21, in scalar and AVX2 builds, so it starts at 2^22. The threshold is
+   a variable only so that --selftest can lower it. */
+#ifndef NTT_SIXSTEP_MIN
+#define NTT_SIXSTEP_MIN ((size_t)1 << 22)
+#endif
+#define NTT_ROW_WORDS ((size_t)1 << 13)
+#define NTT_COL_WORDS ((size_t)1 << 17)
+
+static size_t ntt_sixstep_min = NTT_SIXSTEP_MIN;
+
+/* Square split used by the sharded and stepped transforms. */
+static size_t ntt_sixstep_rows(size_t m) {
+    size_t r = 1;
+    while (r * r < m) r <<= 1;
+    return (r * r > m) ? r >> 1 : r;
+}
+
+static size_t ntt_local_rows(size_t m) {
+    return m > NTT_ROW_WORDS ? m / NTT_ROW_WORDS : 1;
+}
+
+static size_t ntt_col_block(size_t r, size_t c) {
+    size_t b = NTT_COL_WORDS / r;
+    if (b < 16) b = 16;
+    return b < c ? b : c;
+}
+
+/* The six-step twiddle on a column block: row i holds the outputs whose
+   natural index is k = bitrev(i), and column j is multiplied by w^(k * j).
+   Walking k in natural order makes that a geometric sequence down each
+   column, so every column steps its own Montgomery power and the inner
+   loop runs along the row without a dependency chain. cur and step are
+   scratch of cols words each. */
+static void ntt_twiddle_cols(uint32_t* a, size_t rows, size_t cols, size_t j0, uint32_t w,
+                             uint32_t p, uint32_t* cur, uint32_t* step) {
+    unsigned lg = 0;
+    while (((size_t)1 << lg) < rows) ++lg;
+    uint32_t pinv = ntt_pinv(p);
+    uint32_t r32 = (uint32_t)(((uint64_t)1 << 32) % p);
+    uint32_t s = ntt_mulmod(ntt_pow(w, j0, p), r32, p);
+    uint32_t wm = ntt_mulmod(w, r32, p);
+    for (size_t c = 0; c < cols; ++c) {
+        cur[c] = step[c] = s;
+        s = ntt_mont(s, wm, p, pinv);
+    }
+    for (size_t k = 1; k < rows; ++k) {
+        size_t i = 0;
+        for (unsigned b = 0; b < lg; ++b) i |= ((k >> b) & 1) << (lg - 1 - b);
+        uint32_t* row = a + i * cols;
+        size_t c = 0;
+#ifdef NTT_LANES
+        NttVec vp = ntt_vset(p), vpinv = ntt_vset(pinv);
+        for (; c + NTT_LANES <= cols; c += NTT_LANES) {
+            NttVec vc = ntt_vload(cur + c);
+            ntt_vstore(row + c, ntt_vmont(ntt_vload(row + c), vc, vp, vpinv));
+            ntt_vstore(cur + c, ntt_vmont(vc, ntt_vload(step + c), vp, vpinv));
+        }
+#endif
+        for (; c < cols; ++c) {
+            row[c] = ntt_mont(row[c], cur[c], p, pinv);
+            cur[c] = ntt_mont(cur[c], step[c], p, pinv);
+        }
+    }
+}
+
+static void ntt_sixstep_fwd(uint32_t* a, size_t m, const NttTable* t, int k) {
+    uint32_t p = ntt_mod[k];
+    size_t r = ntt_local_rows(m);
+    size_t c = m / r;
+    size_t b = ntt_col_block(r, c);
+    uint32_t w = ntt_pow(ntt_gen[k], (p - 1) / m, p);
+
+    uint32_t* blk = (uint32_t*)malloc((r + 2) * b * sizeof(uint32_t));
+    if (!blk) { perror("malloc"); exit(1); }
+    for (size_t j = 0; j < c; j += b) {
+        ntt_cols_load(blk, a + j, r, c, b);
+        ntt_dif_cols(blk, r, b, t, p);
+        ntt_twiddle_cols(blk, r, b, j, w, p, blk + r * b, blk + (r + 1) * b);
+        ntt_cols_store(a + j, blk, r, c, b);
+    }
+    free(blk);
+    for (size_t i = 0; i < r; ++i) ntt_dif(a + i * c, c, t, p);
+}
+
+static void ntt_sixstep_inv(uint32_t* a, size_t m, const NttTable* t, int k) {
+    uint32_t p = ntt_mod[k];
+    size_t r = ntt_local_rows(m);
+    size_t c = m / r;
+    size_t b = ntt_col_block(r, c);
+    uint32_t w = ntt_pow(ntt_gen[k], p - 1 - (p - 1) / m, p);
+
+    for (size_t i = 0; i < r; ++i) ntt_dit_inv(a + i * c, c, t, p);
+    uint32_t* blk = (uint32_t*)malloc((r + 2) * b * sizeof(uint32_t));
+    if (!blk) { perror("malloc"); exit(1); }
+    for (size_t j = 0; j < c; j += b) {
+        ntt_cols_load(blk, a + j, r, c, b);
+        ntt_twiddle_cols(blk, r, b, j, w, p, blk + r * b, blk + (r + 1) * b);
+        ntt_dit_inv_cols(blk, r, b, t, p);
+        ntt_cols_store(a + j, blk, r, c, b);
+    }
+    free(blk);
+}
+
+static const NttTable* ntt_table_for(int k, size_t m) {
+    return ntt_twiddles(k, m >= ntt_sixstep_min ? m / ntt_local_rows(m) : m);
+}
+
+static void ntt_fwd_pow2(uint32_t* a, size_t m, const NttTable* t, int k) {
+    if (m >= ntt_sixstep_min) ntt_sixstep_fwd(a, m, t, k);
+    else ntt_dif(a, m, t, ntt_mod[k]);
+}
+
+static void ntt_inv_pow2(uint32_t* a, size_t m, const NttTable* t, int k) {
+    if (m >= ntt_sixstep_min) ntt_sixstep_inv(a, m, t, k);
+    else ntt_dit_inv(a, m, t, ntt_mod[k]);
+}
+
+/* x + y + z mod p in [0, p) for inputs below p. */
+static uint32_t ntt_add3(uint32_t x, uint32_t y, uint32_t z, uint32_t p) {
+    uint32_t s = x + y + z;
+    if (s >= 2 * p) s -= 2 * p;
+    return s >= p ? s - p : s;
+}
+
+/* ntt_shoup reduced to [0, p). */
+static uint32_t ntt_shoup_full(uint32_t x, uint32_t w, uint32_t ws, uint32_t p) {
+    uint32_t r = ntt_shoup(x, w, ws, p);
+    return r >= p ? r - p : r;
+}
+
+/* For n = 3m a radix-3 pass splits the input into three length-m
+   transforms, each of which sees the primitive m-th root w_n^3. The fixed
+   cube roots use Shoup products and the per-point twiddles w_n^i, w_n^2i
+   are stepped in Montgomery form, as in ntt_twiddle_rows. Input must be
+   reduced below p; output is below 2p. */
+static void ntt_forward(uint32_t* a, size_t n, int k) {
+    uint32_t p = ntt_mod[k];
+    size_t m = (n & (n - 1)) ? n / 3 : n;
+    const NttTable* t = ntt_table_for(k, m);
+
+    if (m != n) {
+        uint32_t pinv = ntt_pinv(p);
+        uint32_t r32 = (uint32_t)(((uint64_t)1 << 32) % p);
+        uint32_t wn = ntt_pow(ntt_gen[k], (p - 1) / n, p);
+        uint32_t w3 = ntt_pow(wn, m, p), w3sq = ntt_mulmod(w3, w3, p);
+        uint32_t w3s = ntt_shoup_pre(w3, p), w3sqs = ntt_shoup_pre(w3sq, p);
+        uint32_t step1 = ntt_mulmod(wn, r32, p), step2 = ntt_mulmod(ntt_mulmod(wn, wn, p), r32, p);
+        uint32_t t1 = r32, t2 = r32;
+        for (size_t i = 0; i < m; ++i) {
+            uint32_t x0 = a[i], x1 = a[i + m], x2 = a[i + 2 * m];
+            uint32_t y1 = ntt_add3(x0, ntt_shoup_full(x1, w3, w3s, p), ntt_shoup_full(x2, w3sq, w3sqs, p), p);
+            uint32_t y2 = ntt_add3(x0, ntt_shoup_full(x1, w3sq, w3sqs, p), ntt_shoup_full(x2, w3, w3s, p), p);
+            a[i] = ntt_add3(x0, x1, x2, p);
+            a[i + m] = ntt_mont(y1, t1, p, pinv);
+            a[i + 2 * m] = ntt_mont(y2, t2, p, pinv);
+            t1 = ntt_mont(t1, step1, p, pinv);
+            t2 = ntt_mont(t2, step2, p, pinv);
+        }
+    }
+    for (size_t off = 0; off < n; off += m) ntt_fwd_pow2(a + off, m, t, k);
+}
+
+/* Also removes the 2^-32 left behind by ntt_pointwise; output below p.
+   The radix-3 pass folds the scale into its stepped Montgomery twiddles;
+   its inputs are below 4p, which keeps each product under p * 2^32. */
+static void ntt_inverse(uint32_t* a, size_t n, int k) {
+    uint32_t p = ntt_mod[k];
+    size_t m = (n & (n - 1)) ? n / 3 : n;
+    const NttTable* t = ntt_table_for(k, m);
+    uint32_t r32 = (uint32_t)(((uint64_t)1 << 32) % p);
+    uint32_t scale = ntt_mulmod(ntt_pow((uint32_t)n, p - 2, p), r32, p);
+
+    for (size_t off = 0; off < n; off += m) ntt_inv_pow2(a + off, m, t, k);
+
+    if (m == n) {
+        ntt_scale(a, n, scale, p);
+        return;
+    }
+
+    uint32_t pinv = ntt_pinv(p);
+    uint32_t wn = ntt_pow(ntt_gen[k], (p - 1) / n, p);
+    uint32_t wn_inv = ntt_pow(wn, p - 2, p);
+    uint32_t w3 = ntt_pow(wn, m, p), w3sq = ntt_mulmod(w3, w3, p);
+    uint32_t w3s = ntt_shoup_pre(w3, p), w3sqs = ntt_shoup_pre(w3sq, p);
+    uint32_t scales = ntt_shoup_pre(scale, p);
+    uint32_t step1 = ntt_mulmod(wn_inv, r32, p), step2 = ntt_mulmod(ntt_mulmod(wn_inv, wn_inv, p), r32, p);
+    uint32_t c1 = ntt_mulmod(scale, r32, p), c2 = c1;
+    for (size_t i = 0; i < m; ++i) {
+        uint32_t z0 = ntt_shoup_full(a[i], scale, scales, p);
+        uint32_t z1 = ntt_mont(a[i + m], c1, p, pinv);
+        uint32_t z2 = ntt_mont(a[i + 2 * m], c2, p, pinv);
+        a[i] = ntt_add3(z0, z1, z2, p);
+        a[i + m] = ntt_add3(z0, ntt_shoup_full(z1, w3sq, w3sqs, p), ntt_shoup_full(z2, w3, w3s, p), p);
+        a[i + 2 * m] = ntt_add3(z0, ntt_shoup_full(z1, w3, w3s, p), ntt_shoup_full(z2, w3sq, w3sqs, p), p);
+        c1 = ntt_mont(c1, step1, p, pinv);
+        c2 = ntt_mont(c2, step2, p, pinv);
+    }
+}
+
+/* Smallest supported length (2^k or 3 * 2^k) that holds need points. */
+static size_t ntt_size(size_t need) {
+    size_t m = 1, m3 = 3;
+    while (m < need && m < ((size_t)1 << NTT_MAX_LOG2)) m <<= 1;
+    while (m3 < need) m3 <<= 1;
+    return (m >= need && m < m3) ? m : m3;
+}
+
+typedef struct {
+    uint32_t p0_inv_p1;
+    uint32_t p01_inv_p2;
+    uint64_t p01;
+} NttCrt;
+
+static void ntt_crt_init(NttCrt* c) {
+    c->p0_inv_p1 = ntt_pow(ntt_mod[0] % ntt_mod[1], ntt_mod[1] - 2, ntt_mod[1]);
+    c->p01 = (uint64_t)ntt_mod[0] * ntt_mod[1];
+    c->p01_inv_p2 = ntt_pow((uint32_t)(c->p01 % ntt_mod[2]), ntt_mod[2] - 2, ntt_mod[2]);
+}
+
+/* Garner reconstruction; returns bits 32.. of the value, bits 0..31 in *lo. */
+static uint64_t ntt_crt(const NttCrt* c, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t* lo) {
+    uint32_t p1 = ntt_mod[1], p2 = ntt_mod[2];
+    uint32_t t1 = ntt_mulmod((r1 + p1 - r0 % p1) % p1, c->p0_inv_p1, p1);
+    uint64_t x = r0 + (uint64_t)ntt_mod[0] * t1;
+    uint32_t t2 = ntt_mulmod((uint32_t)((r2 + p2 - x % p2) % p2), c->p01_inv_p2, p2);
+    uint64_t s = x + (uint64_t)(uint32_t)c->p01 * t2;
+    *lo = (uint32_t)s;
+    return (s >> 32) + (c->p01 >> 32) * t2;
+}
+
+/* Limbs [lo, hi) of the product from the three residue convolutions, in
+   base `base`, into z[0 .. hi - lo); *carry links consecutive ranges and
+   starts at 0. The last limb (rn - 1) takes the final carry. */
+static void ntt_crt_range(uint32_t* z, uint32_t* const* res, size_t lo, size_t hi, size_t rn,
+                          uint32_t base, uint64_t* carry) {
+    NttCrt crt;
+    ntt_crt_init(&crt);
+    uint64_t cy = *carry;
+    for (size_t i = lo; i < hi && i + 1 < rn; ++i) {
+        uint32_t w0;
+        uint64_t w = ntt_crt(&crt, res[0][i], res[1][i], res[2][i], &w0);
+        uint64_t l = (uint64_t)w0 + (uint32_t)cy;
+        uint64_t h = w + (cy >> 32) + (l >> 32);
+        if (base == 0) {
+            z[i - lo] = (uint32_t)l;
+            cy = h;
+        } else {
+            uint64_t cur = (h % base) << 32 | (uint32_t)l;
+            z[i - lo] = (uint32_t)(cur % base);
+            cy = ((h / base) << 32) + cur / base;
+        }
+    }
+    if (hi >= rn) z[rn - 1 - lo] = (uint32_t)cy;
+    *carry = cy;
+}
+
+static void ntt_crt_limbs(uint32_t* z, uint32_t* const* res, size_t rn, uint32_t base) {
+    uint64_t carry = 0;
+    ntt_crt_range(z, res, 0, rn, rn, base, &carry);
+}
+
+/* Checkpointing of large NTT products (--checkpoint FILE). One product at
+   a time owns the file and saves its progress at most every `interval`
+   seconds: for blocked products the partial sum and the next block, and
+   within a block the residues of the primes already transformed back.
+   The file has a versioned header in native byte order followed by the
+   partial sum and the residues. A product that finds a checkpoint for the
+   same operands resumes from it; a checkpoint of a different product is
+   left alone and the new product runs without one. */
+#define BIG_CKPT_MAGIC "BIGNUMCK"
+#define BIG_CKPT_VERSION 1u
+#define BIG_CKPT_MIN_LIMBS ((size_t)1 << 16)
+#define BIG_CKPT_INTERVAL 60
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t base;
+    uint64_t an, bn;
+    uint64_t key;
+    uint64_t bi, bj;
+    uint64_t zn;
+    uint64_t n;
+    uint32_t stage;
+    uint32_t reserved;
+} BigCkptHeader;
+
+typedef struct {
+    const char* path;
+    unsigned interval;
+    time_t last;
+    int busy;
+    BigCkptHeader h;
+    uint32_t* z;
+    uint32_t* res[3];
+    uint32_t* saved_z;
+    uint32_t* saved_res[3];
+    int saved_stage;
+} BigCkpt;
+
+static BigCkpt big_ckpt;
+static BigMutex big_ckpt_lock = BIG_MUTEX_INIT;
+
+static uint64_t ckpt_key(const uint32_t* a, size_t an, const uint32_t* b, size_t bn, uint32_t base) {
+    Big va = { an, an, (uint32_t*)a }, vb = { bn, bn, (uint32_t*)b };
+    return (big_hash(&va) * 31 + big_hash(&vb)) ^ base;
+}
+
+static void ckpt_save(BigCkpt* ck) {
+    char tmp[1100];
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", ck->path, (long)getpid());
+    FILE* f = fopen(tmp, "wb");
+    if (!f) return;
+    int ok = fwrite(&ck->h, sizeof(ck->h), 1, f) == 1;
+    if (ok && ck->h.zn) ok = fwrite(ck->z, sizeof(uint32_t), (size_t)ck->h.zn, f) == ck->h.zn;
+    for (uint32_t k = 0; ok && k < ck->h.stage; ++k) {
+        ok = fwrite(ck->res[k], sizeof(uint32_t), (size_t)ck->h.n, f) == ck->h.n;
+    }
+    if (fclose(f) != 0) ok = 0;
+    if (ok && rename(tmp, ck->path) != 0) {
+        remove(ck->path);
+        ok = rename(tmp, ck->path) == 0;
+    }
+    if (!ok) {
+        remove(tmp);
+        fprintf(stderr, "checkpoint: cannot write %s\n", ck->path);
+    }
+}
+
+static void ckpt_tick(BigCkpt* ck) {
+    if (!ck) return;
+    time_t now = time(NULL);
+    if (difftime(now, ck->last) < ck->interval) return;
+    ckpt_save(ck);
+    ck->last = now;
+}
+
+static uint32_t* ckpt_read_words(FILE* f, uint64_t n) {
+    uint32_t* p = (uint32_t*)malloc((size_t)n * sizeof(uint32_t));
+    if (!p) { perror("malloc"); exit(1); }
+    if (fread(p, sizeof(uint32_t), (size_t)n, f) != n) {
+        free(p);
+        return NULL;
+    }
+    return p;
+}
+
+/* Returns 1 with the saved state loaded if the file holds this product,
+   0 if there is no usable file, -1 if it belongs to another product. */
+static int ckpt_load(BigCkpt* ck, const BigCkptHeader* want) {
+    FILE* f = fopen(ck->path, "rb");
+    if (!f) return 0;
+    BigCkptHeader h;
+    int rc = -1;
+    if (fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, BIG_CKPT_MAGIC, 8) != 0 ||
+        h.version != BIG_CKPT_VERSION || h.stage > 3) {
+        rc = 0;
+    } else if (h.key == want->key && h.an == want->an && h.bn == want->bn && h.base == want->base) {
+        rc = 1;
+        if (h.zn && !(ck->saved_z = ckpt_read_words(f, h.zn))) rc = 0;
+        for (uint32_t k = 0; rc && k < h.stage; ++k) {
+            if (!(ck->saved_res[k] = ckpt_read_words(f, h.n))) rc = 0;
+        }
+        if (rc) {
+            ck->h = h;
+            ck->saved_stage = (int)h.stage;
+        }
+    }
+    fclose(f);
+    if (rc == 0) {
+        free(ck->saved_z);
+        ck->saved_z = NULL;
+        for (int k = 0; k < 3; ++k) {
+            free(ck->saved_res[k]);
+            ck->saved_res[k] = NULL;
+        }
+    }
+    return rc;
+}
+
+static BigCkpt* ckpt_claim(const uint32_t* a, size_t an, const uint32_t* b, size_t bn, uint32_t base) {
+    BigCkpt* ck = &big_ckpt;
+    if (!ck->path || an + bn < BIG_CKPT_MIN_LIMBS) return NULL;
+    big_mutex_lock(&big_ckpt_lock);
+    if (ck->busy) {
+        big_mutex_unlock(&big_ckpt_lock);
+        return NULL;
+    }
+    ck->busy = 1;
+    big_mutex_unlock(&big_ckpt_lock);
+
+    BigCkptHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, BIG_CKPT_MAGIC, 8);
+    h.version = BIG_CKPT_VERSION;
+    h.base = base;
+    h.an = an;
+    h.bn = bn;
+    h.key = ckpt_key(a, an, b, bn, base);
+    int rc = ckpt_load(ck, &h);
+    if (rc < 0) {
+        big_mutex_lock(&big_ckpt_lock);
+        ck->busy = 0;
+        big_mutex_unlock(&big_ckpt_lock);
+        return NULL;
+    }
+    if (rc == 0) ck->h = h;
+    else fprintf(stderr, "checkpoint: resuming from %s\n", ck->path);
+    ck->z = NULL;
+    ck->last = time(NULL);
+    return ck;
+}
+
+/* The product is complete: its checkpoint is no longer needed. */
+static void ckpt_release(BigCkpt* ck) {
+    if (!ck) return;
+    remove(ck->path);
+    free(ck->saved_z);
+    ck->saved_z = NULL;
+    for (int k = 0; k < 3; ++k) {
+        free(ck->saved_res[k]);
+        ck->saved_res[k] = NULL;
+    }
+    ck->saved_stage = 0;
+    big_mutex_lock(&big_ckpt_lock);
+    ck->busy = 0;
+    big_mutex_unlock(&big_ckpt_lock);
+}
+
+/* The cyclic convolutions of a and b modulo the three primes; res[k]
+   holds ntt_size(an + bn - 1) words and is the caller's to free. */
+static void ntt_residues(uint32_t** res, const uint32_t* a, size_t an,
+                         const uint32_t* b, size_t bn, BigCkpt* ck) {
+    size_t n = ntt_size(an + bn - 1);
+    int sq = (a == b && an == bn);
+    uint32_t* fb = sq ? NULL : (uint32_t*)malloc(n * sizeof(uint32_t));
+    if (!sq && !fb) { perror("malloc"); exit(1); }
+
+    int k0 = 0;
+    if (ck) {
+        if (ck->saved_stage && ck->h.n == n) k0 = ck->saved_stage;
+        for (int k = 0; k < 3; ++k) {
+            if (k < k0) ck->res[k] = res[k] = ck->saved_res[k];
+            else free(ck->saved_res[k]);
+            ck->saved_res[k] = NULL;
+        }
+        ck->saved_stage = 0;
+        ck->h.n = n;
+        ck->h.stage = (uint32_t)k0;
+    }
+
+    for (int k = k0; k < 3; ++k) {
+        uint32_t p = ntt_mod[k];
+        uint32_t* fa = (uint32_t*)malloc(n * sizeof(uint32_t));
+        if (!fa) { perror("malloc"); exit(1); }
+        for (size_t i = 0; i < an; ++i) fa[i] = a[i] % p;
+        memset(fa + an, 0, (n - an) * sizeof(uint32_t));
+        ntt_forward(fa, n, k);
+        if (sq) {
+            ntt_pointwise(fa, fa, n, k);
+        } else {
+            for (size_t i = 0; i < bn; ++i) fb[i] = b[i] % p;
+            memset(fb + bn, 0, (n - bn) * sizeof(uint32_t));
+            ntt_forward(fb, n, k);
+            ntt_pointwise(fa, fb, n, k);
+        }
+        ntt_inverse(fa, n, k);
+        res[k] = fa;
+        if (ck) {
+            ck->res[k] = fa;
+            ck->h.stage = (uint32_t)k + 1;
+            ckpt_tick(ck);
+        }
+    }
+    free(fb);
+}
+
+static void ntt_mul_limbs(uint32_t* z, const uint32_t* a, size_t an,
+                          const uint32_t* b, size_t bn, uint32_t base, BigCkpt* ck) {
+    uint32_t* res[3];
+    ntt_residues(res, a, an, b, bn, ck);
+    ntt_crt_limbs(z, res, an + bn, base);
+    for (int k = 0; k < 3; ++k) free(res[k]);
+}
+
+/* Multi-process sharded NTT (--procs N, POSIX only). The coordinator forks
+   N workers that share one anonymous mapping holding the operands and the
+   A, B and scratch transform arrays. Each transform runs as the six-step
+   layout split into phases: column passes, row passes and the transposes
+   between them are cut into contiguous slices, one per worker, and every
+   phase ends with all workers acknowledging. Phases are driven by
+   fixed-size messages over a ShardLink; the pipe link below is the only
+   transport, and a socket or network link only has to provide the same
+   three calls. The coordinator does the final CRT itself. */
+#define BIG_SHARD_MIN ((size_t)1 << 16)
+
+static unsigned ntt_shard_procs;
+
+enum {
+    SHARD_LOAD,        /* x[i] = operand[i] mod p, zero padded */
+    SHARD_TRANSPOSE_IN,
+    SHARD_COLS_FWD,
+    SHARD_TRANSPOSE_OUT,
+    SHARD_ROWS_FWD,    /* twiddle then DIF along rows */
+    SHARD_POINTWISE,
+    SHARD_ROWS_INV,    /* DIT along rows then inverse twiddle */
+    SHARD_COLS_INV,
+    SHARD_SCALE,
+    SHARD_DONE,
+    SHARD_QUIT
+};
+
+typedef struct {
+    uint32_t op;
+    uint32_t k;
+    uint32_t x;
+    uint32_t reserved;
+    uint64_t lo, hi;
+} ShardMsg;
+
+typedef struct ShardLink {
+    int (*send)(struct ShardLink* l, const ShardMsg* m);
+    int (*recv)(struct ShardLink* l, ShardMsg* m);
+    void (*close)(struct ShardLink* l);
+    int in, out;
+} ShardLink;
+
+/* The transform arrays of one product and what a phase slice needs to
+   interpret them; shared between processes when sharded. */
+typedef struct {
+    uint32_t* opnd[2];
+    size_t opn[2];
+    uint32_t* x[2];
+    uint32_t* buf;
+    size_t m, r, c;
+    const NttTable* tab[3];
+} ShardJob;
+
+static void shard_run(const ShardJob* j, const ShardMsg* msg) {
+    int k = (int)msg->k;
+    uint32_t p = ntt_mod[k];
+    uint32_t* x = j->x[msg->x];
+    const NttTable* t = j->tab[k];
+    size_t lo = (size_t)msg->lo, hi = (size_t)msg->hi, r = j->r, c = j->c;
+
+    switch (msg->op) {
+    case SHARD_LOAD: {
+        const uint32_t* src = j->opnd[msg->x];
+        size_t n = j->opn[msg->x];
+        for (size_t i = lo; i < hi; ++i) x[i] = i < n ? src[i] % p : 0;
+        break;
+    }
+    case SHARD_TRANSPOSE_IN:
+        ntt_transpose(j->buf + lo, r, x + lo * c, c, hi - lo, c);
+        break;
+    case SHARD_COLS_FWD:
+        for (size_t i = lo; i < hi; ++i) ntt_dif(j->buf + i * r, r, t, p);
+        break;
+    case SHARD_TRANSPOSE_OUT:
+        ntt_transpose(x + lo, c, j->buf + lo * r, r, hi - lo, r);
+        break;
+    case SHARD_ROWS_FWD:
+        ntt_twiddle_rows(x, r, lo, hi, c, ntt_pow(ntt_gen[k], (p - 1) / j->m, p), p);
+        for (size_t i = lo; i < hi; ++i) ntt_dif(x + i * c, c, t, p);
+        break;
+    case SHARD_POINTWISE:
+        ntt_pointwise(j->x[0] + lo, j->x[msg->x] + lo, hi - lo, k);
+        break;
+    case SHARD_ROWS_INV:
+        for (size_t i = lo; i < hi; ++i) ntt_dit_inv(x + i * c, c, t, p);
+        ntt_twiddle_rows(x, r, lo, hi, c, ntt_pow(ntt_gen[k], p - 1 - (p - 1) / j->m, p), p);
+        break;
+    case SHARD_COLS_INV:
+        for (size_t i = lo; i < hi; ++i) ntt_dit_inv(j->buf + i * r, r, t, p);
+        break;
+    case SHARD_SCALE: {
+        uint32_t s = ntt_mulmod(ntt_pow((uint32_t)j->m, p - 2, p), (uint32_t)(((uint64_t)1 << 32) % p), p);
+        ntt_scale(x + lo, hi - lo, s, p);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+static int shard_pipe_send(ShardLink* l, const ShardMsg* m) {
+    const char* p = (const char*)m;
+    size_t left = sizeof(*m);
+    while (left) {
+        ssize_t w = write(l->out, p, left);
+        if (w <= 0) return 0;
+        p += w;
+        left -= (size_t)w;
+    }
+    return 1;
+}
+
+static int shard_pipe_recv(ShardLink* l, ShardMsg* m) {
+    char* p = (char*)m;
+    size_t left = sizeof(*m);
+    while (left) {
+        ssize_t r = read(l->in, p, left);
+        if (r <= 0) return 0;
+        p += r;
+        left -= (size_t)r;
+    }
+    return 1;
+}
+
+static void shard_pipe_close(ShardLink* l) {
+    close(l->in);
+    close(l->out);
+}
+
+static void shard_worker(const ShardJob* j, ShardLink* l) {
+    ShardMsg m;
+    while (l->recv(l, &m) && m.op != SHARD_QUIT) {
+        shard_run(j, &m);
+        m.op = SHARD_DONE;
+        if (!l->send(l, &m)) break;
+    }
+    l->close(l);
+    _exit(0);
+}
+
+/* One phase: [0, count) split evenly across the workers, then a barrier. */
+static void shard_phase(ShardLink* links, unsigned procs, uint32_t op, int k, uint32_t x, size_t count) {
+    for (unsigned w = 0; w < procs; ++w) {
+        ShardMsg m;
+        memset(&m, 0, sizeof(m));
+        m.op = op;
+        m.k = (uint32_t)k;
+        m.x = x;
+        m.lo = count * w / procs;
+        m.hi = count * (w + 1) / procs;
+        if (!links[w].send(&links[w], &m)) {
+            fprintf(stderr, "shard: worker %u is gone\n", w);
+            exit(1);
+        }
+    }
+    for (unsigned w = 0; w < procs; ++w) {
+        ShardMsg m;
+        if (!links[w].recv(&links[w], &m) || m.op != SHARD_DONE) {
+            fprintf(stderr, "shard: worker %u is gone\n", w);
+            exit(1);
+        }
+    }
+}
+
+static void shard_forward(ShardLink* links, unsigned procs, const ShardJob* j, int k, uint32_t x) {
+    shard_phase(links, procs, SHARD_LOAD, k, x, j->m);
+    shard_phase(links, procs, SHARD_TRANSPOSE_IN, k, x, j->r);
+    shard_phase(links, procs, SHARD_COLS_FWD, k, x, j->c);
+    shard_phase(links, procs, SHARD_TRANSPOSE_OUT, k, x, j->c);
+    shard_phase(links, procs, SHARD_ROWS_FWD, k, x, j->r);
+}
+
+/* Same contract as ntt_mul_limbs, with a power-of-two transform shared by
+   `procs` worker processes. Returns 0 (z untouched) if the workers could
+   not be started. */
+static int ntt_mul_sharded(uint32_t* z, const uint32_t* a, size_t an,
+                           const uint32_t* b, size_t bn, uint32_t base, unsigned procs) {
+    size_t rn = an + bn;
+    size_t m = 1;
+    while (m < rn - 1) m <<= 1;
+    int sq = (a == b && an == bn);
+
+    ShardJob j;
+    j.m = m;
+    j.r = ntt_sixstep_rows(m);
+    j.c = m / j.r;
+    for (int k = 0; k < 3; ++k) j.tab[k] = ntt_twiddles(k, j.c);
+
+    size_t words = an + bn + 3 * m;
+    void* seg = mmap(NULL, words * sizeof(uint32_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (seg == MAP_FAILED) return 0;
+    uint32_t* w = (uint32_t*)seg;
+    j.opnd[0] = w;
+    j.opnd[1] = w + an;
+    j.opn[0] = an;
+    j.opn[1] = bn;
+    j.x[0] = w + an + bn;
+    j.x[1] = j.x[0] + m;
+    j.buf = j.x[1] + m;
+    memcpy(j.opnd[0], a, an * sizeof(uint32_t));
+    memcpy(j.opnd[1], b, bn * sizeof(uint32_t));
+
+    /* The caller may be one of several threads, and a forked child gets
+       only this one: whatever lock another thread held at fork time (malloc,
+       stdio) stays held for good. So the child does nothing but compute,
+       pipe I/O, the affinity call and _exit; its CPU mask is worked out
+       here beforehand. */
+    ShardLink* links = (ShardLink*)calloc(procs, sizeof(ShardLink));
+    pid_t* pids = (pid_t*)calloc(procs, sizeof(pid_t));
+    unsigned char* masks = (unsigned char*)malloc((size_t)procs * BIG_CPU_MAX);
+    int* cpus = (int*)malloc(procs * sizeof(int));
+    if (!links || !pids || !masks || !cpus) { perror("calloc"); exit(1); }
+    for (unsigned i = 0; i < procs; ++i) cpus[i] = big_affinity_mask(i, masks + (size_t)i * BIG_CPU_MAX);
+    fflush(stdout);
+    fflush(stderr);
+    unsigned started = 0;
+    for (; started < procs; ++started) {
+        int down[2], up[2];
+        if (pipe(down) != 0) break;
+        if (pipe(up) != 0) {
+            close(down[0]); close(down[1]);
+            break;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(down[0]); close(down[1]); close(up[0]); close(up[1]);
+            break;
+        }
+        ShardLink l = { shard_pipe_send, shard_pipe_recv, shard_pipe_close, 0, 0 };
+        if (pid == 0) {
+            for (unsigned i = 0; i < started; ++i) links[i].close(&links[i]);
+            close(down[1]);
+            close(up[0]);
+            l.in = down[0];
+            l.out = up[1];
+            if (cpus[started] >= 0 && !big_affinity_set(masks + (size_t)started * BIG_CPU_MAX)) {
+                static const char msg[] = "Cannot pin a shard worker.\n";
+                ssize_t wr = write(2, msg, sizeof(msg) - 1);
+                (void)wr;
+            }
+            shard_worker(&j, &l);
+        }
+        close(down[0]);
+        close(up[1]);
+        l.in = up[0];
+        l.out = down[1];
+        links[started] = l;
+        pids[started] = pid;
+    }
+
+    int ok = started == procs;
+    if (ok) {
+        uint32_t* res[3];
+        for (int k = 0; k < 3; ++k) {
+            shard_forward(links, procs, &j, k, 0);
+            if (!sq) shard_forward(links, procs, &j, k, 1);
+            shard_phase(links, procs, SHARD_POINTWISE, k, sq ? 0 : 1, m);
+            shard_phase(links, procs, SHARD_ROWS_INV, k, 0, j.r);
+            shard_phase(links, procs, SHARD_TRANSPOSE_IN, k, 0, j.r);
+            shard_phase(links, procs, SHARD_COLS_INV, k, 0, j.c);
+            shard_phase(links, procs, SHARD_TRANSPOSE_OUT, k, 0, j.c);
+            shard_phase(links, procs, SHARD_SCALE, k, 0, m);
+            res[k] = (uint32_t*)malloc((rn - 1) * sizeof(uint32_t));
+            if (!res[k]) { perror("malloc"); exit(1); }
+            memcpy(res[k], j.x[0], (rn - 1) * sizeof(uint32_t));
+        }
+        ntt_crt_limbs(z, res, rn, base);
+        for (int k = 0; k < 3; ++k) free(res[k]);
+    }
+
+    for (unsigned i = 0; i < started; ++i) {
+        ShardMsg q;
+        memset(&q, 0, sizeof(q));
+        q.op = SHARD_QUIT;
+        links[i].send(&links[i], &q);
+        links[i].close(&links[i]);
+        waitpid(pids[i], NULL, 0);
+    }
+    free(links);
+    free(pids);
+    free(masks);
+    free(cpus);
+    munmap(seg, words * sizeof(uint32_t));
+    return ok;
+}
+#else
+static int ntt_mul_sharded(uint32_t* z, const uint32_t* a, size_t an,
+                           const uint32_t* b, size_t bn, uint32_t base, unsigned procs) {
+    (void)z; (void)a; (void)an; (void)b; (void)bn; (void)base; (void)procs;
+    return 0;
+}
+#endif
+
+/* Operands beyond the largest transform are cut into blocks whose block
+   products are added into z at their offsets. */
+static void ntt_mul_blocked(uint32_t* z, const uint32_t* a, size_t an,
+                            const uint32_t* b, size_t bn, uint32_t base) {
+    if (ntt_shard_procs > 1 && an + bn >= BIG_SHARD_MIN && an + bn - 1 <= ((size_t)1 << NTT_MAX_LOG2) &&
+        ntt_mul_sharded(z, a, an, b, bn, base, ntt_shard_procs)) {
+        return;
+    }
+
+    BigCkpt* ck = ckpt_claim(a, an, b, bn, base);
+    if (an + bn - 1 <= NTT_MAX_LEN) {
+        ntt_mul_limbs(z, a, an, b, bn, base, ck);
+        ckpt_release(ck);
+        return;
+    }
+
+    size_t s = NTT_MAX_LEN / 2;
+    uint64_t radix = base ? base : 0x100000000ull;
+    uint32_t* t = (uint32_t*)malloc(2 * s * sizeof(uint32_t));
+    if (!t) { perror("malloc"); exit(1); }
+    size_t i0 = 0, j0 = 0;
+    if (ck && ck->saved_z && ck->h.zn == an + bn) {
+        memcpy(z, ck->saved_z, (an + bn) * sizeof(uint32_t));
+        i0 = (size_t)ck->h.bi;
+        j0 = (size_t)ck->h.bj;
+    } else {
+        memset(z, 0, (an + bn) * sizeof(uint32_t));
+    }
+    if (ck) {
+        ck->z = z;
+        ck->h.zn = an + bn;
+    }
+    for (size_t i = i0; i < an; i += s) {
+        size_t ai = (an - i < s) ? an - i : s;
+        for (size_t j = (i == i0 ? j0 : 0); j < bn; j += s) {
+            size_t bj = (bn - j < s) ? bn - j : s;
+            if (ck && (i != i0 || j != j0)) {
+                ck->h.bi = i;
+                ck->h.bj = j;
+                ck->h.stage = 0;
+                ckpt_tick(ck);
+            }
+            ntt_mul_limbs(t, a + i, ai, b + j, bj, base, ck);
+            uint64_t carry = 0;
+            size_t k = 0;
+            for (; k < ai + bj; ++k) {
+                uint64_t v = (uint64_t)z[i + j + k] + t[k] + carry;
+                z[i + j + k] = (uint32_t)(v % radix);
+                carry = v / radix;
+            }
+            for (; carry; ++k) {
+                uint64_t v = (uint64_t)z[i + j + k] + carry;
+                z[i + j + k] = (uint32_t)(v % radix);
+                carry = v / radix;
+            }
+        }
+    }
+    free(t);
+    ckpt_release(ck);
+}
+
+static void big_mul_ntt(Big* z, const Big* a, const Big* b) {
+    size_t rn = a->n + b->n;
+    big_reserve(z, rn);
+    ntt_mul_blocked(z->d, a->d, a->n, b->d, b->n, 0);
+    z->n = rn;
+    big_normalize(z);
+    if (z->n == 0) big_zero(z);
+}
+
+/* Raw binary output (--bin FILE): the product as little-endian 32-bit
+   limbs, lowest first, written as soon as each limb is final, so the
+   result is never resident as a whole. Below the NTT threshold a
+   column-ordered (Comba) kernel emits limb k once column k is summed.
+   Above it the operands are cut into blocks of s limbs, s being the
+   shorter length but at least BIG_SINK_BLOCK and at most half a
+   transform, and the product is built diagonal by diagonal of blocks:
+   every block product of diagonal d lands at d * s or above, so the low s
+   limbs of a 2s + 2 limb window are final once the diagonal is done.
+   Working memory is thus a few times s, not the length of the product;
+   when both operands fit one block, the CRT of their single transform is
+   emitted in BIG_SINK_WORDS chunks. Exactly big_len(a) + big_len(b) limbs
+   are written (one for a zero product), so the top limb may be zero. */
+#define BIG_SINK_WORDS 4096
+#define BIG_SINK_BLOCK ((size_t)1 << 16)
+
+typedef struct {
+    FILE* f;
+    unsigned char buf[4 * BIG_SINK_WORDS];
+    size_t n;        /* bytes buffered */
+    uint64_t limbs;  /* limbs accepted so far */
+    int ok;
+} BigSink;
+
+static void big_sink_init(BigSink* s, FILE* f) {
+    s->f = f;
+    s->n = 0;
+    s->limbs = 0;
+    s->ok = 1;
+}
+
+static void big_sink_flush(BigSink* s) {
+    if (s->n && s->ok) s->ok = fwrite(s->buf, 1, s->n, s->f) == s->n;
+    s->n = 0;
+}
+
+static void big_sink_put(BigSink* s, const uint32_t* x, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (s->n == sizeof(s->buf)) big_sink_flush(s);
+        unsigned char* p = s->buf + s->n;
+        p[0] = (unsigned char)x[i];
+        p[1] = (unsigned char)(x[i] >> 8);
+        p[2] = (unsigned char)(x[i] >> 16);
+        p[3] = (unsigned char)(x[i] >> 24);
+        s->n += 4;
+    }
+    s->limbs += n;
+}
+
+static void big_mul_stream_columns(const uint32_t* a, size_t an, const uint32_t* b, size_t bn, BigSink* s) {
+    uint64_t lo = 0, hi = 0;
+    for (size_t k = 0; k + 1 < an + bn; ++k) {
+        size_t i0 = (k >= bn) ? k - bn + 1 : 0;
+        size_t i1 = (k < an) ? k : an - 1;
+        for (size_t i = i0; i <= i1; ++i) {
+            uint64_t p = (uint64_t)a[i] * b[k - i];
+            lo += p;
+            hi += lo < p;
+        }
+        uint32_t limb = (uint32_t)lo;
+        big_sink_put(s, &limb, 1);
+        lo = (lo >> 32) | (hi << 32);
+        hi >>= 32;
+    }
+    uint32_t top = (uint32_t)lo;
+    big_sink_put(s, &top, 1);
+}
+
+static void ntt_mul_stream(const uint32_t* a, size_t an, const uint32_t* b, size_t bn, BigSink* s) {
+    uint32_t chunk[BIG_SINK_WORDS];
+    size_t rn = an + bn;
+    size_t bs = (an < bn) ? an : bn;
+    if (bs < BIG_SINK_BLOCK) bs = BIG_SINK_BLOCK;
+    if (bs > NTT_MAX_LEN / 2) bs = NTT_MAX_LEN / 2;
+    if (an <= bs && bn <= bs) {
+        uint32_t* res[3];
+        uint64_t carry = 0;
+        ntt_residues(res, a, an, b, bn, NULL);
+        for (size_t lo = 0; lo < rn; lo += BIG_SINK_WORDS) {
+            size_t hi = (rn - lo < BIG_SINK_WORDS) ? rn : lo + BIG_SINK_WORDS;
+            ntt_crt_range(chunk, res, lo, hi, rn, 0, &carry);
+            big_sink_put(s, chunk, hi - lo);
+        }
+        for (int k = 0; k < 3; ++k) free(res[k]);
+        return;
+    }
+
+    size_t na = (an + bs - 1) / bs, nb = (bn + bs - 1) / bs;
+    uint32_t* t = (uint32_t*)malloc(2 * bs * sizeof(uint32_t));
+    uint32_t* w = (uint32_t*)calloc(2 * bs + 2, sizeof(uint32_t));
+    if (!t || !w) { perror("malloc"); exit(1); }
+    for (size_t d = 0; d + 1 < na + nb; ++d) {
+        size_t i0 = (d >= nb) ? d - nb + 1 : 0;
+        size_t i1 = (d < na) ? d : na - 1;
+        for (size_t i = i0; i <= i1; ++i) {
+            size_t ai = (an - i * bs < bs) ? an - i * bs : bs;
+            size_t bj = (bn - (d - i) * bs < bs) ? bn - (d - i) * bs : bs;
+            ntt_mul_limbs(t, a + i * bs, ai, b + (d - i) * bs, bj, 0, NULL);
+            uint64_t carry = 0;
+            size_t k = 0;
+            for (; k < ai + bj; ++k) {
+                uint64_t v = (uint64_t)w[k] + t[k] + carry;
+                w[k] = (uint32_t)v;
+                carry = v >> 32;
+            }
+            for (; carry; ++k) {
+                uint64_t v = (uint64_t)w[k] + carry;
+                w[k] = (uint32_t)v;
+                carry = v >> 32;
+            }
+        }
+        if (d + 2 < na + nb) {
+            big_sink_put(s, w, bs);
+            memmove(w, w + bs, (bs + 2) * sizeof(uint32_t));
+            memset(w + bs + 2, 0, bs * sizeof(uint32_t));
+        } else {
+            big_sink_put(s, w, rn - d * bs);
+        }
+    }
+    free(t);
+    free(w);
+}
+
+/* Writes |a * b| to the sink; returns 0 on a write error. */
+static int big_mul_to_sink(const Big* a, const Big* b, BigSink* s) {
+    size_t an = big_len(a), bn = big_len(b);
+    if (an == 0 || bn == 0) {
+        uint32_t zero = 0;
+        big_sink_put(s, &zero, 1);
+    } else if (an < BIG_NTT_THRESHOLD || bn < BIG_NTT_THRESHOLD) {
+        big_mul_stream_columns(a->d, an, b->d, bn, s);
+    } else {
+        ntt_mul_stream(a->d, an, b->d, bn, s);
+    }
+    big_sink_flush(s);
+    if (s->ok) s->ok = fflush(s->f) == 0;
+    return s->ok;
+}
+
+/* Floating-point FFT tier. Limbs are cut into b-bit pieces (b <= 16), the
+   two operands are packed as the real and imaginary parts of one complex
+   sequence, and a single forward and inverse transform yield the product.
+   The piece size is the largest one for which Percival's rounding-error
+   bound stays under 1/4, so rounding to the nearest integer is exact;
+   when even 8-bit pieces fail the bound the caller uses the NTT. */
+#define FFT_MIN_BITS 8
+#define FFT_MAX_BITS 16
+
+typedef struct {
+    double* re;
+    double* im;
+    size_t len;
+} FftTable;
+
+/* Immutable once published, like the NTT tables. */
+static const FftTable* fft_tab;
+
+/* Level h (a power of two below len): w[h - 1 + j] = exp(-i pi j / h). */
+static const FftTable* fft_twiddles(size_t len) {
+    big_mutex_lock(&big_table_lock);
+    const FftTable* old = fft_tab;
+    if (old && old->len >= len) {
+        big_mutex_unlock(&big_table_lock);
+        return old;
+    }
+
+    FftTable* t = (FftTable*)malloc(sizeof(FftTable));
+    double* buf = (double*)malloc(2 * len * sizeof(double));
+    if (!t || !buf) { perror("malloc"); exit(1); }
+    t->re = buf;
+    t->im = buf + len;
+    t->len = len;
+    size_t have = old ? old->len : 0;
+    if (have) {
+        memcpy(t->re, old->re, have * sizeof(double));
+        memcpy(t->im, old->im, have * sizeof(double));
+    }
+    const double pi = 3.14159265358979323846;
+    for (size_t h = have ? have : 1; h < len; h <<= 1) {
+        for (size_t j = 0; j < h; ++j) {
+            t->re[h - 1 + j] = cos(pi * (double)j / (double)h);
+            t->im[h - 1 + j] = -sin(pi * (double)j / (double)h);
+        }
+    }
+    fft_tab = t;
+    big_mutex_unlock(&big_table_lock);
+    return t;
+}
+
+/* |error| <= |x| |y| ((1+e)^3n (1+e sqrt5)^(3n+1) (1+b)^3n - 1) with
+   e = 2^-53, b the twiddle error (libm cos/sin are within an ulp) and
+   |x| |y| <= 2 N (2^bits - 1)^2 for the packed sequence. */
+static int fft_bound_ok(unsigned lg, unsigned bits) {
+    double e = ldexp(1.0, -53);
+    double n = (double)lg;
+    double f = expm1(3 * n * log1p(e) + (3 * n + 1) * log1p(e * sqrt(5.0)) + 3 * n * log1p(e));
+    double piece = ldexp(1.0, (int)bits) - 1;
+    return ldexp(2.0, (int)lg) * piece * piece * f < 0.25;
+}
+
+/* Picks the piece size and transform length; returns 0 if none is safe. */
+static int fft_plan(size_t an, size_t bn, unsigned* bits, unsigned* lg) {
+    for (unsigned b = FFT_MAX_BITS; b >= FFT_MIN_BITS; --b) {
+        size_t na = (an * 32 + b - 1) / b, nb = (bn * 32 + b - 1) / b;
+        unsigned l = 0;
+        while (((size_t)1 << l) < na + nb - 1) ++l;
+        if (l < 40 && fft_bound_ok(l, b)) {
+            *bits = b;
+            *lg = l;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void fft_dif(double* re, double* im, size_t n, const FftTable* t) {
+    for (size_t h = n >> 1; h >= 1; h >>= 1) {
+        const double* wr = t->re + h - 1;
+        const double* wi = t->im + h - 1;
+        for (size_t i = 0; i < n; i += 2 * h) {
+            double* xr = re + i;
+            double* xi = im + i;
+            double* yr = xr + h;
+            double* yi = xi + h;
+            size_t j = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+            for (; j + 4 <= h; j += 4) {
+                __m256d ur = _mm256_loadu_pd(xr + j), ui = _mm256_loadu_pd(xi + j);
+                __m256d vr = _mm256_loadu_pd(yr + j), vi = _mm256_loadu_pd(yi + j);
+                __m256d cr = _mm256_loadu_pd(wr + j), ci = _mm256_loadu_pd(wi + j);
+                __m256d dr = _mm256_sub_pd(ur, vr), di = _mm256_sub_pd(ui, vi);
+                _mm256_storeu_pd(xr + j, _mm256_add_pd(ur, vr));
+                _mm256_storeu_pd(xi + j, _mm256_add_pd(ui, vi));
+                _mm256_storeu_pd(yr + j, _mm256_fmsub_pd(dr, cr, _mm256_mul_pd(di, ci)));
+                _mm256_storeu_pd(yi + j, _mm256_fmadd_pd(dr, ci, _mm256_mul_pd(di, cr)));
+            }
+#endif
+            for (; j < h; ++j) {
+                double dr = xr[j] - yr[j], di = xi[j] - yi[j];
+                xr[j] += yr[j];
+                xi[j] += yi[j];
+                yr[j] = dr * wr[j] - di * wi[j];
+                yi[j] = dr * wi[j] + di * wr[j];
+            }
+        }
+    }
+}
+
+/* Inverse of fft_dif up to a factor of n, using conjugated twiddles. */
+static void fft_dit_inv(double* re, double* im, size_t n, const FftTable* t) {
+    for (size_t h = 1; h < n; h <<= 1) {
+        const double* wr = t->re + h - 1;
+        const double* wi = t->im + h - 1;
+        for (size_t i = 0; i < n; i += 2 * h) {
+            double* xr = re + i;
+            double* xi = im + i;
+            double* yr = xr + h;
+            double* yi = xi + h;
+            size_t j = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+            for (; j + 4 <= h; j += 4) {
+                __m256d ur = _mm256_loadu_pd(xr + j), ui = _mm256_loadu_pd(xi + j);
+                __m256d sr = _mm256_loadu_pd(yr + j), si = _mm256_loadu_pd(yi + j);
+                __m256d cr = _mm256_loadu_pd(wr + j), ci = _mm256_loadu_pd(wi + j);
+                __m256d vr = _mm256_fmadd_pd(sr, cr, _mm256_mul_pd(si, ci));
+                __m256d vi = _mm256_fmsub_pd(si, cr, _mm256_mul_pd(sr, ci));
+                _mm256_storeu_pd(xr + j, _mm256_add_pd(ur, vr));
+                _mm256_storeu_pd(xi + j, _mm256_add_pd(ui, vi));
+                _mm256_storeu_pd(yr + j, _mm256_sub_pd(ur, vr));
+                _mm256_storeu_pd(yi + j, _mm256_sub_pd(ui, vi));
+            }
+#endif
+            for (; j < h; ++j) {
+                double vr = yr[j] * wr[j] + yi[j] * wi[j];
+                double vi = yi[j] * wr[j] - yr[j] * wi[j];
+                yr[j] = xr[j] - vr;
+                yi[j] = xi[j] - vi;
+                xr[j] += vr;
+                xi[j] += vi;
+            }
+        }
+    }
+}
+
+static void fft_split(double* dst, size_t n, const uint32_t* src, size_t sn, unsigned bits) {
+    uint64_t buf = 0;
+    unsigned have = 0;
+    size_t k = 0;
+    uint32_t mask = (1u << bits) - 1;
+    for (size_t i = 0; i < n; ++i) {
+        if (have < bits) {
+            if (k < sn) buf |= (uint64_t)src[k++] << have;
+            have += 32;
+        }
+        dst[i] = (double)(buf & mask);
+        buf >>= bits;
+        have -= bits;
+    }
+}
+
+/* z[0 .. an+bn) = a * b; returns 0 (leaving z untouched) if no piece size
+   meets the error bound. If err is given it receives the largest distance
+   of a coefficient from the integer it was rounded to. */
+static int fft_mul_limbs(uint32_t* z, const uint32_t* a, size_t an, const uint32_t* b, size_t bn, double* err) {
+    unsigned bits, lg;
+    if (!fft_plan(an, bn, &bits, &lg)) return 0;
+
+    size_t n = (size_t)1 << lg;
+    size_t na = (an * 32 + bits - 1) / bits, nb = (bn * 32 + bits - 1) / bits;
+    double* re = (double*)calloc(n, sizeof(double));
+    double* im = (double*)calloc(n, sizeof(double));
+    uint32_t* rev = (uint32_t*)malloc(n * sizeof(uint32_t));
+    if (!re || !im || !rev) { perror("malloc"); exit(1); }
+    fft_split(re, na, a, an, bits);
+    fft_split(im, nb, b, bn, bits);
+
+    const FftTable* t = fft_twiddles(n);
+    fft_dif(re, im, n, t);
+
+    /* Position i holds C_k for k = bitrev(i). With X = (C_k + conj C_-k) / 2
+       and Y = (C_k - conj C_-k) / 2i, the product is (C_k^2 - conj C_-k^2) / 4i. */
+    rev[0] = 0;
+    for (size_t i = 1; i < n; ++i) rev[i] = (rev[i >> 1] >> 1) | (uint32_t)((i & 1) << (lg - 1));
+    for (size_t i = 0; i < n; ++i) {
+        size_t j = rev[(n - rev[i]) & (n - 1)];
+        if (j < i) continue;
+        double pr = re[i], pi = im[i], qr = re[j], qi = -im[j];
+        double p2r = pr * pr - pi * pi, p2i = 2 * pr * pi;
+        double q2r = qr * qr - qi * qi, q2i = 2 * qr * qi;
+        re[i] = (p2i - q2i) * 0.25;
+        im[i] = -(p2r - q2r) * 0.25;
+        re[j] = (p2i - q2i) * 0.25;
+        im[j] = (p2r - q2r) * 0.25;
+    }
+    free(rev);
+
+    fft_dit_inv(re, im, n, t);
+
+    double scale = 1.0 / (double)n;
+    size_t rn = an + bn;
+    uint64_t acc = 0, out = 0;
+    unsigned have = 0;
+    size_t k = 0;
+    uint32_t mask = (1u << bits) - 1;
+    double worst = 0;
+    for (size_t i = 0; k < rn; ++i) {
+        if (i < na + nb - 1) {
+            double c = re[i] * scale;
+            long long r = llround(c);
+            if (err && fabs(c - (double)r) > worst) worst = fabs(c - (double)r);
+            acc += (uint64_t)r;
+        }
+        out |= (acc & mask) << have;
+        acc >>= bits;
+        have += bits;
+        if (have >= 32) {
+            z[k++] = (uint32_t)out;
+            out >>= 32;
+            have -= 32;
+        }
+    }
+
+    free(re);
+    free(im);
+    if (err) *err = worst;
+    return 1;
+}
+
+static int fft_preferred(size_t an, size_t bn);
+
+static int big_mul_fft(Big* z, const Big* a, const Big* b) {
+    size_t rn = a->n + b->n;
+    big_reserve(z, rn);
+    if (!fft_mul_limbs(z->d, a->d, a->n, b->d, b->n, NULL)) return 0;
+    z->n = rn;
+    big_normalize(z);
+    if (z->n == 0) big_zero(z);
+    return 1;
+}
+
+/* The sparse path costs one row of bn limb products per nonzero limb of
+   sp. It applies when at most a quarter of the limbs are nonzero, and then
+   only while the rows are cheaper than the fast tiers: up to
+   BIG_SPARSE_ROWS rows always are, beyond that nnz * bn must stay below
+   8 m lg m, about what the three-prime NTT of the m-point product costs in
+   the same units. */
+#define BIG_SPARSE_ROWS 16
+
+static int big_sparse_pays(const Big* sp, const Big* dn) {
+    size_t nz = big_count_nonzero(sp);
+    if (nz * 4 > sp->n) return 0;
+    if (nz <= BIG_SPARSE_ROWS || sp->n < BIG_NTT_THRESHOLD || dn->n < BIG_NTT_THRESHOLD) return 1;
+    size_t m = ntt_size(sp->n + dn->n - 1);
+    unsigned lg = 0;
+    while (((size_t)1 << lg) < m) ++lg;
+    return (double)nz * (double)dn->n < 8.0 * (double)m * lg;
+}
+
+/* Checkpoints (--checkpoint) and worker processes (--procs) only live in
+   ntt_mul_blocked, so products they cover skip the FFT, the learned tier
+   choice and the pooled task path. */
+static int big_ntt_required(size_t an, size_t bn) {
+    if (big_ckpt.path && an + bn >= BIG_CKPT_MIN_LIMBS) return 1;
+    return ntt_shard_procs > 1 && an + bn >= BIG_SHARD_MIN && an + bn - 1 <= ((size_t)1 << NTT_MAX_LOG2);
+}
+
+static int big_mul_learned(Big* z, const Big* a, const Big* b);
+
+static void big_mul_direct(Big* z, const Big* a, const Big* b) {
+    if ((a->n == 0) || (b->n == 0) ||
+        (a->n == 1 && a->d[0] == 0) ||
+        (b->n == 1 && b->d[0] == 0)) {
+        big_zero(z);
+        return;
+    }
+
+    if (a->n == 1 || big_sparse_pays(a, b)) {
+        big_mul_sparse(z, a, b);
+        return;
+    }
+    if (b->n == 1 || big_sparse_pays(b, a)) {
+        big_mul_sparse(z, b, a);
+        return;
+    }
+
+    if (a->n >= BIG_NTT_THRESHOLD && b->n >= BIG_NTT_THRESHOLD && big_ntt_required(a->n, b->n)) {
+        big_mul_ntt(z, a, b);
+        return;
+    }
+    if (big_mul_learned(z, a, b)) return;
+    if (a->n < BIG_NTT_THRESHOLD || b->n < BIG_NTT_THRESHOLD) {
+        big_mul_school(z, a, b);
+    } else if (!fft_preferred(a->n, b->n) || !big_mul_fft(z, a, b)) {
+        big_mul_ntt(z, a, b);
+    }
+}
+
+/* Optional product memo: a bounded LRU map from operand pairs to products,
+   consulted by big_mul for operands of at least BIG_MEMO_MIN_LIMBS. Keys
+   are a 64-bit hash of both operands (order-independent, since the product
+   is); a hit is confirmed by comparing the stored operands. */
+#define BIG_MEMO_MIN_LIMBS 64
+
+typedef struct BigMemoEntry {
+    uint64_t key;
+    Big a, b, z;
+    size_t bytes;
+    struct BigMemoEntry* hnext;
+    struct BigMemoEntry* prev;
+    struct BigMemoEntry* next;
+} BigMemoEntry;
+
+typedef struct {
+    size_t limit;
+    size_t bytes;
+    size_t count;
+    size_t nbuckets;
+    BigMemoEntry** buckets;
+    BigMemoEntry* head;
+    BigMemoEntry* tail;
+    uint64_t hits, misses, evictions;
+} BigMemo;
+
+static BigMemo big_memo;
+static BigMutex big_memo_lock = BIG_MUTEX_INIT;
+
+static void big_memo_unlink(BigMemoEntry* e) {
+    if (e->prev) e->prev->next = e->next; else big_memo.head = e->next;
+    if (e->next) e->next->prev = e->prev; else big_memo.tail = e->prev;
+}
+
+static void big_memo_push_front(BigMemoEntry* e) {
+    e->prev = NULL;
+    e->next = big_memo.head;
+    if (big_memo.head) big_memo.head->prev = e; else big_memo.tail = e;
+    big_memo.head = e;
+}
+
+static void big_memo_evict(void) {
+    BigMemoEntry* e = big_memo.tail;
+    BigMemoEntry** pp = &big_memo.buckets[e->key & (big_memo.nbuckets - 1)];
+    while (*pp != e) pp = &(*pp)->hnext;
+    *pp = e->hnext;
+    big_memo_unlink(e);
+    big_memo.bytes -= e->bytes;
+    --big_memo.count;
+    ++big_memo.evictions;
+    big_free(&e->a); big_free(&e->b); big_free(&e->z);
+    free(e);
+}
+
+static void big_memo_rehash(size_t nbuckets) {
+    BigMemoEntry** nb = (BigMemoEntry**)calloc(nbuckets, sizeof(BigMemoEntry*));
+    if (!nb) { perror("calloc"); exit(1); }
+    for (BigMemoEntry* e = big_memo.head; e; e = e->next) {
+        size_t h = (size_t)(e->key & (nbuckets - 1));
+        e->hnext = nb[h];
+        nb[h] = e;
+    }
+    free(big_memo.buckets);
+    big_memo.buckets = nb;
+    big_memo.nbuckets = nbuckets;
+}
+
+static uint64_t big_memo_key(const Big* a, const Big* b) {
+    uint64_t ha = big_hash(a), hb = big_hash(b);
+    return (ha ^ hb) + (ha < hb ? ha : hb) * 0x9E3779B97F4A7C15ull;
+}
+
+static int big_memo_lookup(Big* z, const Big* a, const Big* b, uint64_t key) {
+    if (!big_memo.nbuckets) return 0;
+    for (BigMemoEntry* e = big_memo.buckets[key & (big_memo.nbuckets - 1)]; e; e = e->hnext) {
+        if (e->key != key) continue;
+        if ((big_cmp(&e->a, a) == 0 && big_cmp(&e->b, b) == 0) ||
+            (big_cmp(&e->a, b) == 0 && big_cmp(&e->b, a) == 0)) {
+            big_memo_unlink(e);
+            big_memo_push_front(e);
+            big_copy(z, &e->z);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void big_memo_insert(const Big* a, const Big* b, const Big* z, uint64_t key) {
+    size_t bytes = sizeof(BigMemoEntry) + (big_len(a) + big_len(b) + big_len(z)) * sizeof(uint32_t);
+    if (bytes > big_memo.limit) return;
+    while (big_memo.bytes + bytes > big_memo.limit) big_memo_evict();
+    if (big_memo.count >= big_memo.nbuckets) big_memo_rehash(big_memo.nbuckets ? 2 * big_memo.nbuckets : 64);
+
+    BigMemoEntry* e = (BigMemoEntry*)malloc(sizeof(BigMemoEntry));
+    if (!e) { perror("malloc"); exit(1); }
+    e->key = key;
+    e->bytes = bytes;
+    big_init(&e->a); big_init(&e->b); big_init(&e->z);
+    big_copy(&e->a, a);
+    big_copy(&e->b, b);
+    big_copy(&e->z, z);
+    size_t h = (size_t)(key & (big_memo.nbuckets - 1));
+    e->hnext = big_memo.buckets[h];
+    big_memo.buckets[h] = e;
+    big_memo_push_front(e);
+    big_memo.bytes += bytes;
+    ++big_memo.count;
+}
+
+static void big_memo_report(FILE* f) {
+    fprintf(f, "memo: %llu hits, %llu misses, %llu evictions, %zu entries, %zu/%zu bytes\n",
+        (unsigned long long)big_memo.hits, (unsigned long long)big_memo.misses,
+        (unsigned long long)big_memo.evictions, big_memo.count, big_memo.bytes, big_memo.limit);
+}
+
+static void big_mul(Big* z, const Big* a, const Big* b) {
+    if (!big_memo.limit || big_len(a) < BIG_MEMO_MIN_LIMBS || big_len(b) < BIG_MEMO_MIN_LIMBS) {
+        big_mul_direct(z, a, b);
+        return;
+    }
+
+    uint64_t key = big_memo_key(a, b);
+    big_mutex_lock(&big_memo_lock);
+    int hit = big_memo_lookup(z, a, b, key);
+    if (hit) ++big_memo.hits;
+    else ++big_memo.misses;
+    big_mutex_unlock(&big_memo_lock);
+    if (hit) return;
+
+    /* z may alias an operand, which must still be intact for the insert. */
+    Big t;
+    big_init(&t);
+    big_mul_direct(&t, a, b);
+    big_mutex_lock(&big_memo_lock);
+    big_memo_insert(a, b, &t, key);
+    big_mutex_unlock(&big_memo_lock);
+    big_copy(z, &t);
+    big_free(&t);
+}
+
+/* Time-sliced multiplication for callers that must stay responsive, such
+   as an event loop: big_mul_step runs whole work units only while the
+   estimate of the next one still fits in budget_ns. It returns 1 once the
+   product is complete, 0 after progress, and -1 without doing anything
+   when even the first unit is predicted to overrun; the caller then needs
+   a larger budget. Units are small by construction. A schoolbook row is
+   cut into BIG_STEP_COLS-limb pieces. The NTT tier lays out each block
+   (buffers and twiddle tables) in a unit of its own, then runs the
+   six-step phases of the sharded path one row, one column or
+   BIG_STEP_ELEMS elements at a time, followed by the CRT and the block
+   accumulation in the same grain. Freshly allocated block buffers are
+   first written in BIG_STEP_ELEMS slices, so that no transpose pays for
+   faulting in thousands of pages at once, and they are kept until
+   big_mul_task_free rather than unmapped in the last unit. The cost of a unit is estimated per
+   kind as the slowest recent one, decaying by 1/8 per unit so that a page
+   fault or a preemption does not shrink every later step. An estimate
+   that refuses a step decays too, so such an outlier cannot stall the
+   task for good. A kind not yet timed is guessed at BIG_STEP_GUESS_NS per
+   element, several times the measured rate. Operands must stay unchanged
+   until the task is done. */
+#define BIG_STEP_COLS 1024
+#define BIG_STEP_ELEMS ((size_t)1 << 12)
+#define BIG_STEP_BLOCK ((size_t)1 << (NTT_MAX_LOG2 - 1))
+#define BIG_STEP_GUESS_NS 8
+
+enum {
+    STEP_COPY = SHARD_QUIT + 1,    /* residues of prime k out of x[0] */
+    STEP_CRT,
+    STEP_ACCUMULATE,               /* block product into z */
+    STEP_TOUCH,                    /* first write to fresh block buffers */
+    STEP_SETUP                     /* lay out the next block */
+};
+
+typedef struct {
+    uint32_t op, k, x;
+    size_t count, grain;
+} BigStepPhase;
+
+typedef struct {
+    const uint32_t* a;
+    const uint32_t* b;
+    size_t an, bn;
+    Big z;
+    int ntt, done, setup;
+    uint64_t unit_ns[STEP_SETUP + 1];  /* by phase op; [0] for schoolbook */
+    size_t i, j;               /* schoolbook row and column, or block offsets */
+    size_t rn;                 /* limbs of the current block product */
+    ShardJob job;
+    size_t mcap, rcap;
+    uint32_t* res[3];
+    uint32_t* prod;
+    BigStepPhase phase[3 * 18 + 3];
+    int nphase, cur;
+    size_t pos;
+    uint64_t carry;
+} BigMulTask;
+
+static uint64_t big_now_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER f, c;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&c);
+    return (uint64_t)(c.QuadPart / f.QuadPart) * 1000000000ull +
+           (uint64_t)(c.QuadPart % f.QuadPart) * 1000000000ull / (uint64_t)f.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* CPU time of the calling thread: what a step itself spent, without the
+   time the scheduler gave to someone else. */
+static uint64_t big_cpu_ns(void) {
+#ifdef _WIN32
+    FILETIME c, e, k, u;
+    if (!GetThreadTimes(GetCurrentThread(), &c, &e, &k, &u)) return big_now_ns();
+    return ((((uint64_t)k.dwHighDateTime << 32) | k.dwLowDateTime) +
+            (((uint64_t)u.dwHighDateTime << 32) | u.dwLowDateTime)) * 100;
+#else
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return big_now_ns();
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static void step_add_phase(BigMulTask* t, uint32_t op, int k, uint32_t x, size_t count, size_t grain) {
+    BigStepPhase* ph = &t->phase[t->nphase++];
+    ph->op = op;
+    ph->k = (uint32_t)k;
+    ph->x = x;
+    ph->count = count;
+    ph->grain = grain ? grain : 1;
+}
+
+static void step_add_forward(BigMulTask* t, int k, uint32_t x) {
+    const ShardJob* j = &t->job;
+    step_add_phase(t, SHARD_LOAD, k, x, j->m, BIG_STEP_ELEMS);
+    step_add_phase(t, SHARD_TRANSPOSE_IN, k, x, j->r, BIG_STEP_ELEMS / j->c);
+    step_add_phase(t, SHARD_COLS_FWD, k, x, j->c, 1);
+    step_add_phase(t, SHARD_TRANSPOSE_OUT, k, x, j->c, BIG_STEP_ELEMS / j->r);
+    step_add_phase(t, SHARD_ROWS_FWD, k, x, j->r, 1);
+}
+
+/* Transform length of the block product a[i ..] * b[j ..]. */
+static size_t step_block_size(const BigMulTask* t, size_t* ai, size_t* bj) {
+    *ai = (t->an - t->i < BIG_STEP_BLOCK) ? t->an - t->i : BIG_STEP_BLOCK;
+    *bj = (t->bn - t->j < BIG_STEP_BLOCK) ? t->bn - t->j : BIG_STEP_BLOCK;
+    size_t m = 1;
+    while (m < *ai + *bj - 1) m <<= 1;
+    return m;
+}
+
+/* Lays out the phases for the block product a[i ..] * b[j ..]. */
+static void step_block_start(BigMulTask* t) {
+    size_t ai, bj;
+    size_t m = step_block_size(t, &ai, &bj);
+    int sq = t->a == t->b && t->an == t->bn && t->i == t->j;
+    t->rn = ai + bj;
+
+    ShardJob* j = &t->job;
+    int fresh = m > t->mcap;
+    if (fresh) {
+        free(j->x[0]);
+        j->x[0] = (uint32_t*)malloc(3 * m * sizeof(uint32_t));
+        if (!j->x[0]) { perror("malloc"); exit(1); }
+        t->mcap = m;
+    }
+    if (t->rn > t->rcap) {
+        for (int k = 0; k < 3; ++k) {
+            free(t->res[k]);
+            t->res[k] = (uint32_t*)malloc(t->rn * sizeof(uint32_t));
+            if (!t->res[k]) { perror("malloc"); exit(1); }
+        }
+        free(t->prod);
+        t->prod = (uint32_t*)malloc(t->rn * sizeof(uint32_t));
+        if (!t->prod) { perror("malloc"); exit(1); }
+        t->rcap = t->rn;
+    }
+    j->x[1] = j->x[0] + m;
+    j->buf = j->x[1] + m;
+    j->opnd[0] = (uint32_t*)(t->a + t->i);
+    j->opnd[1] = (uint32_t*)(t->b + t->j);
+    j->opn[0] = ai;
+    j->opn[1] = bj;
+    j->m = m;
+    j->r = ntt_sixstep_rows(m);
+    j->c = m / j->r;
+    for (int k = 0; k < 3; ++k) j->tab[k] = ntt_twiddles(k, j->c);
+
+    t->nphase = 0;
+    if (fresh) step_add_phase(t, STEP_TOUCH, 0, 0, 3 * m, BIG_STEP_ELEMS);
+    for (int k = 0; k < 3; ++k) {
+        step_add_forward(t, k, 0);
+        if (!sq) step_add_forward(t, k, 1);
+        step_add_phase(t, SHARD_POINTWISE, k, sq ? 0 : 1, m, BIG_STEP_ELEMS);
+        step_add_phase(t, SHARD_ROWS_INV, k, 0, j->r, 1);
+        step_add_phase(t, SHARD_TRANSPOSE_IN, k, 0, j->r, BIG_STEP_ELEMS / j->c);
+        step_add_phase(t, SHARD_COLS_INV, k, 0, j->c, 1);
+        step_add_phase(t, SHARD_TRANSPOSE_OUT, k, 0, j->c, BIG_STEP_ELEMS / j->r);
+        step_add_phase(t, SHARD_SCALE, k, 0, m, BIG_STEP_ELEMS);
+        step_add_phase(t, STEP_COPY, k, 0, t->rn - 1, BIG_STEP_ELEMS);
+    }
+    step_add_phase(t, STEP_CRT, 0, 0, t->rn, BIG_STEP_ELEMS);
+    step_add_phase(t, STEP_ACCUMULATE, 0, 0, t->rn, BIG_STEP_ELEMS);
+    t->cur = 0;
+    t->pos = 0;
+    t->carry = 0;
+}
+
+static void step_release(BigMulTask* t) {
+    free(t->job.x[0]);
+    t->job.x[0] = NULL;
+    for (int k = 0; k < 3; ++k) {
+        free(t->res[k]);
+        t->res[k] = NULL;
+    }
+    free(t->prod);
+    t->prod = NULL;
+    t->mcap = t->rcap = 0;
+}
+
+/* The block buffers are kept until big_mul_task_free: unmapping them is
+   one call that no budget could split. */
+static void step_finish(BigMulTask* t) {
+    big_normalize(&t->z);
+    if (t->z.n == 0) big_zero(&t->z);
+    t->done = 1;
+}
+
+/* z[at ..] += carry, which always fits since z holds the whole product. */
+static void step_ripple(uint32_t* z, size_t at, uint64_t carry) {
+    for (; carry; ++at) {
+        uint64_t v = (uint64_t)z[at] + carry;
+        z[at] = (uint32_t)v;
+        carry = v >> 32;
+    }
+}
+
+static void step_school_unit(BigMulTask* t) {
+    size_t end = (t->bn - t->j < BIG_STEP_COLS) ? t->bn : t->j + BIG_STEP_COLS;
+    uint64_t ai = t->a[t->i];
+    if (ai) {
+        uint32_t* z = t->z.d + t->i;
+        uint64_t carry = 0;
+        for (size_t k = t->j; k < end; ++k) {
+            uint64_t v = ai * t->b[k] + z[k] + carry;
+            z[k] = (uint32_t)v;
+            carry = v >> 32;
+        }
+        step_ripple(z, end, carry);
+    }
+    t->j = end;
+    if (t->j == t->bn) {
+        t->j = 0;
+        if (++t->i == t->an) step_finish(t);
+    }
+}
+
+static void step_ntt_advance(BigMulTask* t, size_t hi);
+
+static void step_ntt_unit(BigMulTask* t) {
+    if (t->setup) {
+        step_block_start(t);
+        t->setup = 0;
+        return;
+    }
+    const BigStepPhase* ph = &t->phase[t->cur];
+    size_t lo = t->pos;
+    size_t hi = (ph->count - lo < ph->grain) ? ph->count : lo + ph->grain;
+
+    switch (ph->op) {
+    case STEP_TOUCH:
+        memset(t->job.x[0] + lo, 0, (hi - lo) * sizeof(uint32_t));
+        break;
+    case STEP_COPY:
+        memcpy(t->res[ph->k] + lo, t->job.x[0] + lo, (hi - lo) * sizeof(uint32_t));
+        break;
+    case STEP_CRT:
+        ntt_crt_range(t->prod + lo, t->res, lo, hi, t->rn, 0, &t->carry);
+        break;
+    case STEP_ACCUMULATE: {
+        uint32_t* z = t->z.d + t->i + t->j;
+        uint64_t carry = t->carry;
+        for (size_t k = lo; k < hi; ++k) {
+            uint64_t v = (uint64_t)z[k] + t->prod[k] + carry;
+            z[k] = (uint32_t)v;
+            carry = v >> 32;
+        }
+        if (hi == ph->count) step_ripple(z, hi, carry);
+        t->carry = carry;
+        break;
+    }
+    default: {
+        ShardMsg msg;
+        msg.op = ph->op;
+        msg.k = ph->k;
+        msg.x = ph->x;
+        msg.reserved = 0;
+        msg.lo = lo;
+        msg.hi = hi;
+        shard_run(&t->job, &msg);
+        break;
+    }
+    }
+
+    step_ntt_advance(t, hi);
+}
+
+/* Marks the current phase done up to hi, moving on to the next phase or
+   block as needed. */
+static void step_ntt_advance(BigMulTask* t, size_t hi) {
+    t->pos = hi;
+    if (t->pos < t->phase[t->cur].count) return;
+    t->pos = 0;
+    t->carry = 0;
+    if (++t->cur < t->nphase) return;
+    t->j += BIG_STEP_BLOCK;
+    if (t->j >= t->bn) {
+        t->j = 0;
+        t->i += BIG_STEP_BLOCK;
+    }
+    if (t->i >= t->an) step_finish(t);
+    else t->setup = 1;
+}
+
+static void big_mul_task_init(BigMulTask* t, const Big* a, const Big* b) {
+    memset(t, 0, sizeof(*t));
+    big_init(&t->z);
+    t->a = a->d;
+    t->b = b->d;
+    t->an = big_len(a);
+    t->bn = big_len(b);
+    if (t->an == 0 || t->bn == 0) {
+        big_zero(&t->z);
+        t->done = 1;
+        return;
+    }
+    big_reserve(&t->z, t->an + t->bn);
+    memset(t->z.d, 0, (t->an + t->bn) * sizeof(uint32_t));
+    t->z.n = t->an + t->bn;
+    t->ntt = t->an >= BIG_NTT_THRESHOLD && t->bn >= BIG_NTT_THRESHOLD;
+    t->setup = t->ntt;
+}
+
+static unsigned step_lg(size_t n) {
+    unsigned lg = 0;
+    while (((size_t)1 << lg) < n) ++lg;
+    return lg;
+}
+
+/* Kind of the next unit, indexing unit_ns. */
+static uint32_t step_kind(const BigMulTask* t) {
+    if (!t->ntt) return 0;
+    return t->setup ? STEP_SETUP : t->phase[t->cur].op;
+}
+
+/* First guess for a kind not yet timed: BIG_STEP_GUESS_NS per element
+   touched, per butterfly for row and column transforms, and per twiddle
+   for a block layout, whose buffers are only touched by later units. */
+static uint64_t step_guess_ns(const BigMulTask* t) {
+    size_t work;
+    if (!t->ntt) {
+        work = BIG_STEP_COLS;
+    } else if (t->setup) {
+        size_t ai, bj;
+        size_t m = step_block_size(t, &ai, &bj);
+        work = 3 * (m / ntt_sixstep_rows(m));
+    } else {
+        const BigStepPhase* ph = &t->phase[t->cur];
+        const ShardJob* j = &t->job;
+        size_t n = (ph->count - t->pos < ph->grain) ? ph->count - t->pos : ph->grain;
+        size_t per = 1;
+        switch (ph->op) {
+        case SHARD_TRANSPOSE_IN: per = j->c; break;
+        case SHARD_TRANSPOSE_OUT: per = j->r; break;
+        case SHARD_COLS_FWD: case SHARD_COLS_INV: per = j->r * step_lg(j->r); break;
+        case SHARD_ROWS_FWD: case SHARD_ROWS_INV: per = j->c * step_lg(j->c); break;
+        default: break;
+        }
+        work = n * per;
+    }
+    return (uint64_t)work * BIG_STEP_GUESS_NS;
+}
+
+static int big_mul_step(BigMulTask* t, uint64_t budget_ns) {
+    if (t->done) return 1;
+    uint64_t now = big_now_ns();
+    uint64_t deadline = now + budget_ns;
+    int ran = 0;
+    while (!t->done) {
+        uint64_t* est = &t->unit_ns[step_kind(t)];
+        uint64_t guess = *est ? *est : step_guess_ns(t);
+        if (now + guess > deadline) {
+            if (!ran) *est -= *est >> 3;
+            break;
+        }
+        uint64_t start = now;
+        if (t->ntt) step_ntt_unit(t);
+        else step_school_unit(t);
+        now = big_now_ns();
+        uint64_t d = now - start;
+        *est = (!*est || d > *est) ? d : *est - (*est >> 3);
+        ran = 1;
+    }
+    return t->done ? 1 : ran ? 0 : -1;
+}
+
+/* Moves the finished product into z. */
+static void big_mul_task_result(BigMulTask* t, Big* z) {
+    Big old = *z;
+    *z = t->z;
+    t->z = old;
+}
+
+static void big_mul_task_free(BigMulTask* t) {
+    step_release(t);
+    big_free(&t->z);
+}
+
+/* Runs a task to completion, spreading each six-step phase over the
+   executor. A phase is cut into one slice per BIG_PAR_MIN_ELEMS transform
+   elements, capped by the executor's size and by `threads` unless that
+   is 0, so small transforms stay on the caller; how many slices actually
+   run elsewhere depends on how many workers are free. The CRT, the
+   accumulation and the schoolbook tier stay on the caller. */
+#define BIG_PAR_MIN_ELEMS ((size_t)1 << 16)
+
+typedef struct {
+    const BigMulTask* t;
+    const BigStepPhase* ph;
+    size_t lo, n, slices;
+} StepLoop;
+
+static void step_loop_slice(void* arg, size_t i) {
+    const StepLoop* s = (const StepLoop*)arg;
+    ShardMsg msg;
+    msg.op = s->ph->op;
+    msg.k = s->ph->k;
+    msg.x = s->ph->x;
+    msg.reserved = 0;
+    msg.lo = s->lo + s->n * i / s->slices;
+    msg.hi = s->lo + s->n * (i + 1) / s->slices;
+    shard_run(&s->t->job, &msg);
+}
+
+static void big_mul_task_run(BigMulTask* t, const BigExecutor* ex, unsigned threads) {
+    while (!t->done) {
+        if (!t->ntt) {
+            step_school_unit(t);
+            continue;
+        }
+        if (t->setup) {
+            step_ntt_unit(t);
+            continue;
+        }
+        const BigStepPhase* ph = &t->phase[t->cur];
+        StepLoop s;
+        s.t = t;
+        s.ph = ph;
+        s.lo = t->pos;
+        s.n = ph->count - t->pos;
+        s.slices = t->job.m / BIG_PAR_MIN_ELEMS;
+        if (s.slices > big_exec_size(ex)) s.slices = big_exec_size(ex);
+        if (threads && s.slices > threads) s.slices = threads;
+        if (s.slices > s.n) s.slices = s.n;
+        if (s.slices < 2 || ph->op >= SHARD_DONE) {
+            step_ntt_unit(t);
+            continue;
+        }
+        big_exec_for(ex, s.slices, step_loop_slice, &s);
+        step_ntt_advance(t, ph->count);
+    }
+}
+
+/* big_mul for a task running on an executor: products large enough to
+   split go through the task path when some worker is free right now, and
+   through the sequential tiers (FFT, memo and all) otherwise. */
+static void big_mul_pooled(Big* z, const Big* a, const Big* b, const BigExecutor* ex) {
+    size_t an = big_len(a), bn = big_len(b);
+    if (!big_exec_idle(ex) || an < BIG_NTT_THRESHOLD || bn < BIG_NTT_THRESHOLD || an + bn < 2 * BIG_PAR_MIN_ELEMS ||
+        big_ntt_required(an, bn) || big_sparse_pays(a, b) || big_sparse_pays(b, a)) {
+        big_mul(z, a, b);
+        return;
+    }
+    BigMulTask t;
+    big_mul_task_init(&t, a, b);
+    big_mul_task_run(&t, ex, 0);
+    big_mul_task_result(&t, z);
+    big_mul_task_free(&t);
+}
+
+/* Cost model for deadline-aware dispatch, in nanoseconds per unit of
+   work: a limb product for the schoolbook and sparse tiers, lg * 2^lg for
+   the FFT, and m * lg m per prime for the NTT, doubled for 3 * 2^k
+   lengths. Transforms that outgrow the cache cost BIG_COST_GROWTH more
+   per unit for every doubling past 2^BIG_COST_FFT_LG (FFT) or
+   2^BIG_COST_NTT_LG (NTT) points. The pooled task path runs power-of-two
+   NTTs with `serial` of its time (CRT, accumulation, hand-offs) on one
+   thread. The defaults were measured on an AVX2 desktop. */
+#define BIG_COST_GROWTH 0.25
+#define BIG_COST_FFT_LG 14
+#define BIG_COST_NTT_LG 18
+
+typedef struct {
+    double school, fft, ntt, task, serial;
+} BigCostModel;
+
+static BigCostModel big_cost = { 1.0, 2.3, 2.5, 3.5, 0.1 };
+
+enum { TIER_SPARSE, TIER_SCHOOL, TIER_FFT, TIER_NTT, TIER_TASK };
+
+typedef struct {
+    int tier;
+    unsigned threads;
+    double ns;
+} BigPlan;
+
+/* Online feedback for the cost model (--learn). Every timed product moves
+   the measured / predicted ratio of its tier and size bucket (lg of the
+   product length) towards what it saw: a running mean over the first
+   BIG_LEARN_WEIGHT samples, then an EWMA with weight 1/BIG_LEARN_WEIGHT.
+   Predictions scale by the ratio, so load, SMT siblings and frequency
+   scaling shift the crossovers. Buckets without samples keep the fixed
+   model. The ratios are kept in the --cache directory between runs. */
+#define BIG_LEARN_BUCKETS 40
+#define BIG_LEARN_WEIGHT 8
+#define BIG_LEARN_MIN_LIMBS 32
+#define BIG_LEARN_EXPLORE 16
+
+typedef struct {
+    double ratio[TIER_TASK + 1][BIG_LEARN_BUCKETS];
+    uint32_t samples[TIER_TASK + 1][BIG_LEARN_BUCKETS];
+} BigCostLearned;
+
+static struct {
+    int on;
+    BigCostLearned m;
+    uint64_t choices, explored, timed;
+} big_learn;
+
+static BigMutex big_learn_lock = BIG_MUTEX_INIT;
+
+static unsigned big_learn_bucket(size_t rn) {
+    unsigned k = 0;
+    while (k + 1 < BIG_LEARN_BUCKETS && (rn >> (k + 1)) != 0) ++k;
+    return k;
+}
+
+static double big_learn_ratio(int tier, size_t rn) {
+    if (!big_learn.on) return 1.0;
+    unsigned k = big_learn_bucket(rn);
+    big_mutex_lock(&big_learn_lock);
+    double r = big_learn.m.samples[tier][k] ? big_learn.m.ratio[tier][k] : 1.0;
+    big_mutex_unlock(&big_learn_lock);
+    return r;
+}
+
+static double big_cost_scale(unsigned lg, unsigned cache_lg) {
+    return 1.0 + BIG_COST_GROWTH * (lg > cache_lg ? lg - cache_lg : 0);
+}
+
+static double big_ntt_units(size_t m) {
+    unsigned lg = 0;
+    while (((size_t)1 << lg) < m) ++lg;
+    return 3.0 * (double)m * lg * ((m & (m - 1)) ? 2 : 1) * big_cost_scale(lg, BIG_COST_NTT_LG);
+}
+
+/* Time of one tier under the fixed model, or -1 where it does not apply. */
+static double big_tier_base_ns(int tier, size_t an, size_t bn, unsigned threads) {
+    size_t rn = an + bn;
+    switch (tier) {
+    case TIER_SCHOOL:
+        return (double)an * (double)bn * big_cost.school;
+    case TIER_FFT: {
+        unsigned bits, lg;
+        if (rn > NTT_MAX_LEN || !fft_plan(an, bn, &bits, &lg)) return -1;
+        return ldexp((double)lg, (int)lg) * big_cost_scale(lg, BIG_COST_FFT_LG) * big_cost.fft;
+    }
+    case TIER_NTT: {
+        if (rn - 1 <= NTT_MAX_LEN) return big_ntt_units(ntt_size(rn - 1)) * big_cost.ntt;
+        size_t s = NTT_MAX_LEN / 2;
+        double blocks = (double)((an + s - 1) / s) * (double)((bn + s - 1) / s);
+        return blocks * big_ntt_units(ntt_size(2 * s - 1)) * big_cost.ntt;
+    }
+    case TIER_TASK: {
+        size_t s = BIG_STEP_BLOCK;
+        size_t ai = an < s ? an : s, bj = bn < s ? bn : s, m = 1;
+        while (m < ai + bj - 1) m <<= 1;
+        double blocks = (double)((an + s - 1) / s) * (double)((bn + s - 1) / s);
+        double t = blocks * big_ntt_units(m) * big_cost.task;
+        return t * (big_cost.serial + (1.0 - big_cost.serial) / threads);
+    }
+    default:
+        return -1;
+    }
+}
+
+/* Predicted time of one tier, or -1 where the tier does not apply. */
+static double big_tier_ns(int tier, size_t an, size_t bn, unsigned threads) {
+    double ns = big_tier_base_ns(tier, an, bn, threads);
+    return ns < 0 ? ns : ns * big_learn_ratio(tier, an + bn);
+}
+
+/* Whether big_mul_direct should try the FFT before the NTT: the cost model
+   above, which with --learn also follows the measured ratios. On the
+   reference desktop the FFT won only where the NTT needs a 3 * 2^k length
+   and the FFT at most 8 * 2^k points (e.g. 20k limbs 8 ms against 14 ms,
+   300k 246 ms against 281 ms), and lost everywhere else (600k 1671 ms
+   against 689 ms). */
+static int fft_preferred(size_t an, size_t bn) {
+    double fft = big_tier_ns(TIER_FFT, an, bn, 1);
+    return fft >= 0 && fft < big_tier_ns(TIER_NTT, an, bn, 1);
+}
+
+/* Folds one measured product into the learned ratios. A single sample
+   moves a trained ratio by at most 4x, so one preempted run cannot throw
+   a bucket far off. */
+static void big_learn_record(int tier, size_t an, size_t bn, unsigned threads, uint64_t ns) {
+    if (!big_learn.on) return;
+    double base = big_tier_base_ns(tier, an, bn, threads);
+    if (base <= 0) return;
+    unsigned k = big_learn_bucket(an + bn);
+    double x = (double)ns / base;
+    big_mutex_lock(&big_learn_lock);
+    uint32_t* n = &big_learn.m.samples[tier][k];
+    double* r = &big_learn.m.ratio[tier][k];
+    if (*n) {
+        if (x > 4 * *r) x = 4 * *r;
+        if (x < *r / 4) x = *r / 4;
+    }
+    if (*n < BIG_LEARN_WEIGHT) ++*n;
+    *r += (x - *r) / *n;
+    ++big_learn.timed;
+    big_mutex_unlock(&big_learn_lock);
+}
+
+/* Picks the cheapest plan in cores that fits budget_ns: the fastest
+   single-threaded tier if it fits, else the task path with the fewest
+   threads (up to max_threads) that fits. Returns 0 when nothing fits,
+   with *p set to the fastest plan. */
+static int big_mul_plan(BigPlan* p, const Big* a, const Big* b, uint64_t budget_ns, unsigned max_threads) {
+    size_t an = big_len(a), bn = big_len(b);
+    p->threads = 1;
+    if (an <= 1 || bn <= 1 || big_sparse_pays(a, b) || big_sparse_pays(b, a)) {
+        size_t nz = big_count_nonzero(a) < big_count_nonzero(b) ? big_count_nonzero(a) : big_count_nonzero(b);
+        p->tier = TIER_SPARSE;
+        p->ns = (double)nz * (double)(an > bn ? an : bn) * big_cost.school;
+        return p->ns <= (double)budget_ns;
+    }
+
+    p->tier = TIER_SCHOOL;
+    p->ns = big_tier_ns(TIER_SCHOOL, an, bn, 1);
+    if (an >= BIG_NTT_THRESHOLD && bn >= BIG_NTT_THRESHOLD && big_ntt_required(an, bn)) {
+        p->tier = TIER_NTT;
+        p->ns = big_tier_ns(TIER_NTT, an, bn, 1);
+    } else if (an >= BIG_NTT_THRESHOLD && bn >= BIG_NTT_THRESHOLD) {
+        for (int tier = TIER_FFT; tier <= TIER_NTT; ++tier) {
+            double ns = big_tier_ns(tier, an, bn, 1);
+            if (ns >= 0 && ns < p->ns) {
+                p->tier = tier;
+                p->ns = ns;
+            }
+        }
+        if (p->ns <= (double)budget_ns) return 1;
+        /* The task path splits no finer than BIG_PAR_MIN_ELEMS per slice. */
+        size_t s = an + bn - 1 < BIG_STEP_BLOCK * 2 ? an + bn - 1 : BIG_STEP_BLOCK * 2, m = 1;
+        while (m < s) m <<= 1;
+        if (max_threads > m / BIG_PAR_MIN_ELEMS) max_threads = (unsigned)(m / BIG_PAR_MIN_ELEMS);
+        for (unsigned t = 2; t <= max_threads; ++t) {
+            double ns = big_tier_ns(TIER_TASK, an, bn, t);
+            if (ns < p->ns) {
+                p->tier = TIER_TASK;
+                p->threads = t;
+                p->ns = ns;
+            }
+            if (ns <= (double)budget_ns) return 1;
+        }
+    }
+    return p->ns <= (double)budget_ns;
+}
+
+/* z = a * b if the cost model says it can finish within budget_ns using
+   the calling thread plus the executor's workers idle right now; otherwise
+   returns 0 at once without touching z. *est_ns receives the predicted
+   time of the chosen (or fastest) plan. */
+static int big_mul_deadline(Big* z, const Big* a, const Big* b, uint64_t budget_ns,
+                            const BigExecutor* ex, uint64_t* est_ns) {
+    unsigned max_threads = 1 + big_exec_idle(ex);
+    BigPlan p;
+    int ok = big_mul_plan(&p, a, b, budget_ns, max_threads);
+    if (est_ns) *est_ns = (uint64_t)p.ns;
+    if (!ok) return 0;
+
+    if (big_is_zero(a) || big_is_zero(b)) {
+        big_zero(z);
+        return 1;
+    }
+    size_t an = big_len(a), bn = big_len(b);
+    uint64_t t0 = big_now_ns();
+    switch (p.tier) {
+    case TIER_SCHOOL:
+        big_mul_school(z, a, b);
+        big_normalize(z);
+        if (z->n == 0) big_zero(z);
+        break;
+    case TIER_FFT:
+        if (!big_mul_fft(z, a, b)) big_mul_ntt(z, a, b);
+        break;
+    case TIER_NTT:
+        big_mul_ntt(z, a, b);
+        break;
+    case TIER_TASK: {
+        BigMulTask t;
+        big_mul_task_init(&t, a, b);
+        big_mul_task_run(&t, ex, p.threads);
+        big_mul_task_result(&t, z);
+        big_mul_task_free(&t);
+        break;
+    }
+    default:
+        big_mul_direct(z, a, b);
+        return 1;
+    }
+    big_learn_record(p.tier, an, bn, p.threads, big_now_ns() - t0);
+    return 1;
+}
+
+/* With --learn, big_mul_direct lets the learned model choose among the
+   schoolbook, FFT and NTT tiers for dense operands of BIG_LEARN_MIN_LIMBS
+   or more; smaller products are too quick to time. Every
+   BIG_LEARN_EXPLORE-th choice runs the runner-up instead if it is
+   predicted within 2x of the best, so a tier that lost under load is
+   retried once the load is gone. Returns 0 to fall back to the fixed
+   crossovers. */
+static int big_mul_learned(Big* z, const Big* a, const Big* b) {
+    size_t an = a->n, bn = b->n;
+    if (!big_learn.on || an < BIG_LEARN_MIN_LIMBS || bn < BIG_LEARN_MIN_LIMBS) return 0;
+
+    double ns[TIER_NTT + 1];
+    int best = TIER_SCHOOL, next = -1;
+    for (int tier = TIER_SCHOOL; tier <= TIER_NTT; ++tier) {
+        ns[tier] = big_tier_ns(tier, an, bn, 1);
+        if (ns[tier] < 0 || tier == best) continue;
+        if (ns[tier] < ns[best]) {
+            next = best;
+            best = tier;
+        } else if (next < 0 || ns[tier] < ns[next]) {
+            next = tier;
+        }
+    }
+    int tier = best;
+    big_mutex_lock(&big_learn_lock);
+    if (next >= 0 && ns[next] < 2 * ns[best] && ++big_learn.choices % BIG_LEARN_EXPLORE == 0) {
+        tier = next;
+        ++big_learn.explored;
+    }
+    big_mutex_unlock(&big_learn_lock);
+
+    uint64_t t0 = big_now_ns();
+    if (tier == TIER_SCHOOL) big_mul_school(z, a, b);
+    else if (tier == TIER_NTT || !big_mul_fft(z, a, b)) big_mul_ntt(z, a, b);
+    big_learn_record(tier, an, bn, 1, big_now_ns() - t0);
+    return 1;
+}
+
+/* Reads the learned ratios from the cache directory; a missing or foreign
+   file leaves the fixed model. Read with stdio rather than mapped, since
+   big_learn_save replaces the file. */
+static void big_learn_load(void) {
+    if (!big_cache_dir || !*big_cache_dir) return;
+    char path[1024];
+    big_cache_path(path, sizeof(path), BIG_CACHE_COST, BIG_LEARN_BUCKETS);
+    FILE* f = fopen(path, "rb");
+    if (!f) return;
+    BigCacheHeader h;
+    BigCostLearned m;
+    int ok = fread(&h, sizeof(h), 1, f) == 1 && fread(&m, sizeof(m), 1, f) == 1 &&
+        memcmp(h.magic, BIG_CACHE_MAGIC, 8) == 0 && h.version == BIG_CACHE_VERSION &&
+        h.kind == BIG_CACHE_COST && h.param == BIG_LEARN_BUCKETS && h.words == sizeof(m) / 4 &&
+        big_cache_sum(big_cache_mix(BIG_CACHE_SEED, (const uint32_t*)&m, sizeof(m) / 4)) == h.sum;
+    fclose(f);
+    for (int t = 0; ok && t <= TIER_TASK; ++t) {
+        for (int k = 0; k < BIG_LEARN_BUCKETS; ++k) {
+            if (m.samples[t][k] > BIG_LEARN_WEIGHT || !(m.ratio[t][k] > 1e-6 && m.ratio[t][k] < 1e6)) ok = 0;
+        }
+    }
+    if (ok) big_learn.m = m;
+}
+
+/* Saves the learned ratios and reports on stderr; registered with atexit. */
+static void big_learn_save(void) {
+    big_mutex_lock(&big_learn_lock);
+    BigCostLearned m = big_learn.m;
+    uint64_t timed = big_learn.timed, explored = big_learn.explored, choices = big_learn.choices;
+    big_mutex_unlock(&big_learn_lock);
+    if (timed) {
+        const uint32_t* part = (const uint32_t*)&m;
+        big_cache_store(BIG_CACHE_COST, BIG_LEARN_BUCKETS, &part, 1, sizeof(m) / 4);
+    }
+    fflush(stdout);
+    fprintf(stderr, "cost model: %llu products timed, %llu of %llu close choices explored\n",
+        (unsigned long long)timed, (unsigned long long)explored, (unsigned long long)choices);
+}
+
+/* Relaxed (online) multiplication after van der Hoeven: limbs of a and b
+   arrive one pair at a time, and big_relaxed_push returns limb n of the
+   product as soon as limbs 0 .. n of both operands are known. Limb n of
+   a * b only depends on those limbs, so it can be final early. The
+   product plane of pairs (i, j) is tiled by squares. Row 0 and column 0
+   are added one term at a time. For i in [m, 2m), with m a power of two,
+   the row is cut into m x m squares a[m .. 2m) x b[qm .. (q+1)m), q >= 1,
+   and, when q >= 2, their mirror images. Each square is added as soon as
+   its last limb arrives, i.e. at step (q+1)m - 1, and only touches limbs
+   (q+1)m and above. Squares of side m recur every m steps, so the total
+   cost is O(M(n) log n), and squares of BIG_NTT_THRESHOLD limbs or more
+   go through the fast tiers. */
+typedef struct {
+    Big a, b;
+    Big z;                 /* sum of the squares added so far */
+    Big ta, tb, tp;        /* scratch for large squares */
+    size_t n;              /* limbs received */
+} BigRelaxed;
+
+static void big_relaxed_init(BigRelaxed* r) {
+    big_init(&r->a);
+    big_init(&r->b);
+    big_init(&r->z);
+    big_init(&r->ta);
+    big_init(&r->tb);
+    big_init(&r->tp);
+    r->n = 0;
+}
+
+static void big_relaxed_free(BigRelaxed* r) {
+    big_free(&r->a);
+    big_free(&r->b);
+    big_free(&r->z);
+    big_free(&r->ta);
+    big_free(&r->tb);
+    big_free(&r->tp);
+    r->n = 0;
+}
+
+/* z[at ..] += x[0 .. xn); the carry out always fits in z. */
+static void relaxed_add_at(Big* z, size_t at, const uint32_t* x, size_t xn) {
+    uint64_t carry = 0;
+    size_t k = 0;
+    for (; k < xn; ++k) {
+        uint64_t v = (uint64_t)z->d[at + k] + x[k] + carry;
+        z->d[at + k] = (uint32_t)v;
+        carry = v >> 32;
+    }
+    for (k += at; carry; ++k) {
+        uint64_t v = (uint64_t)z->d[k] + carry;
+        z->d[k] = (uint32_t)v;
+        carry = v >> 32;
+    }
+}
+
+/* z[at ..] += x[0 .. m) * y[0 .. m). */
+static void relaxed_square(BigRelaxed* r, size_t at, const uint32_t* x, const uint32_t* y, size_t m) {
+    Big* z = &r->z;
+    if (m < BIG_NTT_THRESHOLD) {
+        for (size_t i = 0; i < m; ++i) {
+            uint64_t xi = x[i], carry = 0;
+            if (!xi) continue;
+            uint32_t* zi = z->d + at + i;
+            for (size_t j = 0; j < m; ++j) {
+                uint64_t v = xi * y[j] + zi[j] + carry;
+                zi[j] = (uint32_t)v;
+                carry = v >> 32;
+            }
+            for (size_t k = m; carry; ++k) {
+                uint64_t v = (uint64_t)zi[k] + carry;
+                zi[k] = (uint32_t)v;
+                carry = v >> 32;
+            }
+        }
+        return;
+    }
+    big_reserve(&r->ta, m);
+    big_reserve(&r->tb, m);
+    memcpy(r->ta.d, x, m * sizeof(uint32_t));
+    memcpy(r->tb.d, y, m * sizeof(uint32_t));
+    r->ta.n = r->tb.n = m;
+    big_normalize(&r->ta);
+    big_normalize(&r->tb);
+    if (r->ta.n == 0 || r->tb.n == 0) return;
+    big_mul_direct(&r->tp, &r->ta, &r->tb);
+    relaxed_add_at(z, at, r->tp.d, big_len(&r->tp));
+}
+
+/* Takes limb n of both operands and returns limb n of the product. */
+static uint32_t big_relaxed_push(BigRelaxed* r, uint32_t a, uint32_t b) {
+    size_t n = r->n++;
+    big_reserve(&r->a, n + 1);
+    big_reserve(&r->b, n + 1);
+    r->a.d[n] = a;
+    r->b.d[n] = b;
+    r->a.n = r->b.n = n + 1;
+
+    /* Everything added so far is below a[0 .. n] * b[0 .. n]. */
+    size_t zn = 2 * (n + 1);
+    if (r->z.cap < zn) {
+        size_t old = r->z.n;
+        big_reserve(&r->z, zn);
+        memset(r->z.d + old, 0, (r->z.cap - old) * sizeof(uint32_t));
+        r->z.n = r->z.cap;
+    }
+
+    const uint32_t* ad = r->a.d;
+    const uint32_t* bd = r->b.d;
+    uint32_t t[2];
+    uint64_t v = (uint64_t)ad[n] * bd[0];
+    t[0] = (uint32_t)v;
+    t[1] = (uint32_t)(v >> 32);
+    relaxed_add_at(&r->z, n, t, 2);
+    if (n > 0) {
+        v = (uint64_t)ad[0] * bd[n];
+        t[0] = (uint32_t)v;
+        t[1] = (uint32_t)(v >> 32);
+        relaxed_add_at(&r->z, n, t, 2);
+    }
+    for (size_t m = 1; 2 * m <= n + 1 && (n + 1) % m == 0; m <<= 1) {
+        size_t q = (n + 1) / m - 1;
+        relaxed_square(r, n + 1, ad + m, bd + q * m, m);
+        if (q >= 2) relaxed_square(r, n + 1, bd + m, ad + q * m, m);
+    }
+    return r->z.d[n];
+}
+
+/* The whole product of the limbs received so far. Squares that would
+   only have been added by later pushes are still missing from the
+   accumulator, so this multiplies the operands outright. */
+static void big_relaxed_result(const BigRelaxed* r, Big* z) {
+    if (r->n == 0) {
+        big_zero(z);
+        return;
+    }
+    big_mul_direct(z, &r->a, &r->b);
+}
+
+/* Truncated product: z ~= floor(a * b / 2^(32 * cut)) with cut chosen so
+   that about `keep` high limbs remain. Columns more than two limbs below
+   the cut are never formed, so the result may fall short by a few units.
+   Where the cost model predicts the full fast product to beat those
+   columns, the full product is formed instead and its low limbs dropped,
+   which gives the exact floor. */
+static size_t big_mulhi(Big* z, const Big* a, const Big* b, size_t keep) {
+    size_t an = big_len(a), bn = big_len(b);
+    size_t rn = an + bn;
+    if (an == 0 || bn == 0) {
+        big_zero(z);
+        return 0;
+    }
+    if (keep + 2 >= rn) {
+        big_mul(z, a, b);
+        return 0;
+    }
+
+    size_t cut = rn - keep;
+    size_t lo = cut - 2;
+    if (an >= BIG_NTT_THRESHOLD && bn >= BIG_NTT_THRESHOLD) {
+        double school = 0;
+        for (size_t i = 0; i < an; ++i) {
+            if (i + bn > lo) school += (double)(i + bn - (lo > i ? lo : i));
+        }
+        double fast = big_tier_ns(TIER_NTT, an, bn, 1);
+        double fft = big_tier_ns(TIER_FFT, an, bn, 1);
+        if (fft >= 0 && fft < fast) fast = fft;
+        if (fast < school * big_cost.school) {
+            big_mul(z, a, b);
+            big_shr(z, z, cut * 32);
+            return cut;
+        }
+    }
+    size_t zn = rn - lo;
+
+    big_reserve(z, zn);
+    memset(z->d, 0, zn * sizeof(uint32_t));
+    z->n = zn;
+
+    for (size_t i = 0; i < an; ++i) {
+        size_t j0 = (lo > i) ? lo - i : 0;
+        if (j0 >= bn) continue;
+        uint64_t carry = 0;
+        uint64_t ai = a->d[i];
+        for (size_t j = j0; j < bn; ++j) {
+            uint64_t sum = (uint64_t)z->d[i + j - lo] + ai * (uint64_t)b->d[j] + carry;
+            z->d[i + j - lo] = (uint32_t)sum;
+            carry = sum >> 32;
+        }
+        for (size_t k = i + bn - lo; carry; ++k) {
+            uint64_t t = (uint64_t)z->d[k] + carry;
+            z->d[k] = (uint32_t)t;
+            carry = t >> 32;
+        }
+    }
+
+    memmove(z->d, z->d + 2, (zn - 2) * sizeof(uint32_t));
+    z->n = zn - 2;
+    big_normalize(z);
+    if (z->n == 0) big_zero(z);
+    return cut;
+}
+
+static void big_from_u64(Big* x, uint64_t v) {
+    big_reserve(x, 2);
+    x->d[0] = (uint32_t)v;
+    x->d[1] = (uint32_t)(v >> 32);
+    x->n = 2;
+    big_normalize(x);
+    if (x->n == 0) big_zero(x);
+}
+
+static int big_to_u64(const Big* x, uint64_t* v) {
+    size_t n = big_len(x);
+    if (n > 2) return 0;
+    *v = (n > 0 ? x->d[0] : 0) | (n > 1 ? (uint64_t)x->d[1] << 32 : 0);
+    return 1;
+}
+
+/* Up to 64 bits of x starting at bit pos. */
+static uint64_t big_bits_at(const Big* x, size_t pos, unsigned count) {
+    uint64_t v = 0;
+    size_t n = big_len(x);
+    size_t limb = pos / 32;
+    unsigned off = (unsigned)(pos % 32);
+    for (unsigned k = 0; k < 3 && limb + k < n; ++k) {
+        uint64_t d = x->d[limb + k];
+        if (k == 0) v = d >> off;
+        else if (32 * k - off < 64) v |= d << (32 * k - off);
+    }
+    return count < 64 ? v & ((1ull << count) - 1) : v;
+}
+
+static int big_any_bits_below(const Big* x, size_t pos) {
+    size_t limb = pos / 32;
+    for (size_t i = 0; i < limb && i < x->n; ++i) {
+        if (x->d[i]) return 1;
+    }
+    unsigned off = (unsigned)(pos % 32);
+    return off && limb < x->n && (x->d[limb] & ((1u << off) - 1));
+}
+
+/* Round-to-nearest-even; overflows to +inf like any other conversion. */
+static double big_to_double(const Big* x) {
+    size_t bl = big_bitlen(x);
+    if (bl <= 53) return (double)big_bits_at(x, 0, 53);
+
+    size_t shift = bl - 53;
+    uint64_t m = big_bits_at(x, shift, 53);
+    int round = (int)big_bits_at(x, shift - 1, 1);
+    if (round && ((m & 1) || big_any_bits_below(x, shift - 1))) {
+        if (++m == (1ull << 53)) {
+            m >>= 1;
+            ++shift;
+        }
+    }
+    if (shift > 2000) return HUGE_VAL;
+    return ldexp((double)m, (int)shift);
+}
+
+static double big_log2(const Big* x) {
+    size_t bl = big_bitlen(x);
+    if (bl == 0) return -HUGE_VAL;
+    if (bl <= 64) return log2((double)big_bits_at(x, 0, 64));
+    return log2((double)big_bits_at(x, bl - 64, 64)) + (double)(bl - 64);
+}
+
+static double big_log10(const Big* x) {
+    return big_log2(x) * 0.30102999566398119521;
+}
+
+/* big_pow10_tab[i] = 10^(2^i), built by squaring or mapped from the table
+   cache. Mapped entries point into read-only memory and are never freed. */
+static Big big_pow10_tab[64];
+static unsigned big_pow10_count;
+static BigMutex big_pow10_lock = BIG_MUTEX_INIT;
+
+static const Big* big_pow10_2k(unsigned i) {
+    big_mutex_lock(&big_pow10_lock);
+    while (big_pow10_count <= i) {
+        unsigned j = big_pow10_count;
+        Big* e = &big_pow10_tab[j];
+        uint64_t words;
+        const uint32_t* c = big_cache_load(BIG_CACHE_POW10, j, &words);
+        if (c && words > 0 && c[words - 1] != 0) {
+            e->d = (uint32_t*)c;
+            e->n = e->cap = (size_t)words;
+        } else {
+            big_init(e);
+            if (j == 0) big_from_u64(e, 10);
+            else big_mul(e, &big_pow10_tab[j - 1], &big_pow10_tab[j - 1]);
+            const uint32_t* const out[1] = { e->d };
+            big_cache_store(BIG_CACHE_POW10, j, out, 1, e->n);
+        }
+        big_pow10_count = j + 1;
+    }
+    big_mutex_unlock(&big_pow10_lock);
+    return &big_pow10_tab[i];
+}
+
+static void big_pow10(Big* z, size_t k) {
+    Big t;
+    big_init(&t);
+    big_from_u64(z, 1);
+    for (unsigned i = 0; k; k >>= 1, ++i) {
+        if (k & 1) {
+            big_mul(&t, z, big_pow10_2k(i));
+            big_copy(z, &t);
+        }
+    }
+    big_free(&t);
+}
+
+/* Exact decimal digit count. The log estimate settles it unless x sits
+   within rounding error of a power of ten; only then is 10^k built. */
+static size_t big_dec_digits(const Big* x) {
+    size_t bl = big_bitlen(x);
+    if (bl == 0) return 1;
+
+    double l = big_log10(x);
+    double eps = 1e-12 + (double)bl * 1e-15;
+    double f = floor(l);
+    if (l - f > eps && f + 1 - l > eps) return (size_t)f + 1;
+
+    size_t k = (size_t)floor(l + 0.5);
+    Big p;
+    big_init(&p);
+    big_pow10(&p, k);
+    size_t digits = big_cmp(x, &p) >= 0 ? k + 1 : k;
+    big_free(&p);
+    return digits;
+}
+
+/* Schoolbook long division (Knuth D): q = a / b, r = a % b. Either output
+   may be NULL or alias an input. Returns 0 if b is zero. */
+static int big_divmod(Big* q, Big* r, const Big* a, const Big* b) {
+    size_t n = big_len(b), an = big_len(a);
+    if (n == 0) return 0;
+    if (big_cmp(a, b) < 0) {
+        if (r) big_copy(r, a);
+        if (q) big_zero(q);
+        return 1;
+    }
+
+    size_t m = an - n;
+    Big u, v, qt;
+    big_init(&u); big_init(&v); big_init(&qt);
+    big_reserve(&qt, m + 1);
+    memset(qt.d, 0, (m + 1) * sizeof(uint32_t));
+    qt.n = m + 1;
+
+    if (n == 1) {
+        uint64_t rem = 0, d = b->d[0];
+        for (size_t i = an; i-- > 0; ) {
+            uint64_t cur = (rem << 32) | a->d[i];
+            if (i <= m) qt.d[i] = (uint32_t)(cur / d);
+            rem = cur % d;
+        }
+        if (r) big_from_u64(r, rem);
+    } else {
+        unsigned s = 0;
+        while (!(b->d[n - 1] << s & 0x80000000u)) ++s;
+        big_shl(&v, b, 0, s);
+        big_reserve(&u, an + 1);
+        for (size_t i = 0; i < an; ++i) {
+            u.d[i] = s ? (a->d[i] << s) | (i ? a->d[i - 1] >> (32 - s) : 0) : a->d[i];
+        }
+        u.d[an] = s ? a->d[an - 1] >> (32 - s) : 0;
+        u.n = an + 1;
+
+        uint64_t vt = v.d[n - 1], vs = v.d[n - 2];
+        for (size_t j = m + 1; j-- > 0; ) {
+            uint64_t num = ((uint64_t)u.d[j + n] << 32) | u.d[j + n - 1];
+            uint64_t qh = num / vt, rh = num % vt;
+            while (qh > 0xffffffffull || qh * vs > ((rh << 32) | u.d[j + n - 2])) {
+                --qh;
+                rh += vt;
+                if (rh > 0xffffffffull) break;
+            }
+
+            int64_t borrow = 0;
+            uint64_t carry = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t p = qh * v.d[i] + carry;
+                carry = p >> 32;
+                int64_t t = (int64_t)u.d[i + j] - (int64_t)(uint32_t)p + borrow;
+                u.d[i + j] = (uint32_t)t;
+                borrow = t >> 32;
+            }
+            int64_t t = (int64_t)u.d[j + n] - (int64_t)carry + borrow;
+            u.d[j + n] = (uint32_t)t;
+
+            if (t < 0) {
+                --qh;
+                uint64_t c = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    uint64_t w = (uint64_t)u.d[i + j] + v.d[i] + c;
+                    u.d[i + j] = (uint32_t)w;
+                    c = w >> 32;
+                }
+                u.d[j + n] += (uint32_t)c;
+            }
+            qt.d[j] = (uint32_t)qh;
+        }
+        if (r) {
+            u.n = n;
+            big_normalize(&u);
+            big_shr(r, &u, s);
+        }
+    }
+
+    if (q) {
+        big_normalize(&qt);
+        if (qt.n == 0) big_zero(&qt);
+        big_copy(q, &qt);
+    }
+    big_free(&u); big_free(&v); big_free(&qt);
+    return 1;
+}
+
+/* Carry-save accumulator: each 64-bit word holds a 32-bit limb plus up to
+   32 bits of unpropagated carry. Every add deposits at most one 32-bit
+   "unit" per word, so carries only need resolving once slack runs out. */
+typedef struct {
+    size_t n;
+    size_t cap;
+    uint64_t* d;
+    uint64_t slack;
+} BigAcc;
+
+#define BIG_ACC_SLACK 0xffffffffull
+
+static void big_acc_init(BigAcc* acc) {
+    acc->n = 0;
+    acc->cap = 0;
+    acc->d = NULL;
+    acc->slack = BIG_ACC_SLACK;
+}
+
+static void big_acc_free(BigAcc* acc) {
+    free(acc->d);
+    big_acc_init(acc);
+}
+
+static void big_acc_grow(BigAcc* acc, size_t need) {
+    if (need <= acc->n) return;
+    if (acc->cap < need) {
+        size_t nc = acc->cap ? acc->cap : 4;
+        while (nc < need) {
+            if (nc > (SIZE_MAX >> 1)) {
+                fprintf(stderr, "capacity overflow\n");
+                exit(1);
+            }
+            nc <<= 1;
+        }
+        void* p = realloc(acc->d, nc * sizeof(uint64_t));
+        if (!p) { perror("realloc"); exit(1); }
+        acc->d = (uint64_t*)p;
+        acc->cap = nc;
+    }
+    memset(acc->d + acc->n, 0, (need - acc->n) * sizeof(uint64_t));
+    acc->n = need;
+}
+
+static void big_acc_resolve(BigAcc* acc) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < acc->n; ++i) {
+        uint64_t t = acc->d[i] + carry;
+        acc->d[i] = (uint32_t)t;
+        carry = t >> 32;
+    }
+    while (carry) {
+        big_acc_grow(acc, acc->n + 1);
+        acc->d[acc->n - 1] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    while (acc->n > 0 && acc->d[acc->n - 1] == 0) acc->n--;
+    acc->slack = BIG_ACC_SLACK;
+}
+
+static void big_acc_spend(BigAcc* acc, uint64_t units) {
+    if (units > acc->slack) big_acc_resolve(acc);
+    acc->slack -= units;
+}
+
+static void big_acc_add(BigAcc* acc, const Big* x) {
+    big_acc_spend(acc, 1);
+    big_acc_grow(acc, x->n);
+    uint64_t* d = acc->d;
+    for (size_t i = 0; i < x->n; ++i) d[i] += x->d[i];
+}
+
+static void big_acc_addmul_u32(BigAcc* acc, const Big* x, uint32_t m) {
+    if (x->n == 0 || m == 0) return;
+    big_acc_spend(acc, 2);
+    big_acc_grow(acc, x->n + 1);
+    uint64_t* d = acc->d;
+    for (size_t i = 0; i < x->n; ++i) d[i] += (uint32_t)((uint64_t)x->d[i] * m);
+    for (size_t i = 0; i < x->n; ++i) d[i + 1] += ((uint64_t)x->d[i] * m) >> 32;
+}
+
+static void big_acc_addmul(BigAcc* acc, const Big* a, const Big* b) {
+    if (a->n == 0 || b->n == 0) return;
+    if (a->n > b->n) { const Big* t = a; a = b; b = t; }
+    if (2 * (uint64_t)a->n > BIG_ACC_SLACK) {
+        Big t;
+        big_init(&t);
+        big_mul(&t, a, b);
+        big_acc_add(acc, &t);
+        big_free(&t);
+        return;
+    }
+    big_acc_spend(acc, 2 * (uint64_t)a->n);
+    big_acc_grow(acc, a->n + b->n);
+    size_t bn = b->n;
+    for (size_t i = 0; i < a->n; ++i) {
+        uint64_t ai = a->d[i];
+        uint64_t* lo = acc->d + i;
+        uint64_t* hi = acc->d + i + 1;
+        for (size_t j = 0; j < bn; ++j) lo[j] += (uint32_t)(ai * b->d[j]);
+        for (size_t j = 0; j < bn; ++j) hi[j] += (ai * b->d[j]) >> 32;
+    }
+}
+
+static void big_acc_get(BigAcc* acc, Big* x) {
+    big_acc_resolve(acc);
+    if (acc->n == 0) {
+        big_zero(x);
+        return;
+    }
+    big_reserve(x, acc->n);
+    for (size_t i = 0; i < acc->n; ++i) x->d[i] = (uint32_t)acc->d[i];
+    x->n = acc->n;
+}
+
+static void big_print_hex(const Big* x) {
+    if (x->n == 0 || (x->n == 1 && x->d[0] == 0)) {
+        puts("0x0");
+        return;
+    }
+    printf("0x");
+    printf("%x", x->d[x->n - 1]);
+    for (size_t k = x->n - 1; k-- > 0; ) {
+        printf("%08x", x->d[k]);
+    }
+    puts("");
+}
+
+/* Decimal digits by repeated division by 10^9, least significant chunk
+   first; quadratic, meant for script output rather than bulk conversion. */
+static void big_print_dec(const Big* x) {
+    size_t n = big_len(x);
+    if (n == 0) {
+        puts("0");
+        return;
+    }
+    uint32_t* t = (uint32_t*)malloc(n * sizeof(uint32_t));
+    uint32_t* chunks = (uint32_t*)malloc((n * 32 / 29 + 2) * sizeof(uint32_t));
+    if (!t || !chunks) { perror("malloc"); exit(1); }
+    memcpy(t, x->d, n * sizeof(uint32_t));
+    size_t k = 0;
+    while (n > 0) {
+        uint64_t rem = 0;
+        for (size_t i = n; i-- > 0; ) {
+            uint64_t cur = (rem << 32) | t[i];
+            t[i] = (uint32_t)(cur / 1000000000u);
+            rem = cur % 1000000000u;
+        }
+        chunks[k++] = (uint32_t)rem;
+        while (n > 0 && t[n - 1] == 0) --n;
+    }
+    printf("%u", chunks[k - 1]);
+    while (k-- > 1) printf("%09u", chunks[k - 1]);
+    puts("");
+    free(t);
+    free(chunks);
+}
+
+/* Sign-magnitude wrapper; all arithmetic goes through the unsigned
+   kernels and only the sign bookkeeping lives here. */
+typedef struct {
+    Big mag;
+    int neg;
+} SBig;
+
+static void sbig_init(SBig* x) {
+    big_init(&x->mag);
+    x->neg = 0;
+}
+
+static void sbig_free(SBig* x) {
+    big_free(&x->mag);
+    x->neg = 0;
+}
+
+static int sbig_from_dec(SBig* x, const char* s) {
+    return big_from_dec_signed(&x->mag, &x->neg, s);
+}
+
+static void sbig_from_i64(SBig* x, int64_t v) {
+    x->neg = v < 0;
+    big_from_u64(&x->mag, x->neg ? 0 - (uint64_t)v : (uint64_t)v);
+}
+
+static void sbig_mul(SBig* z, const SBig* a, const SBig* b) {
+    int neg = a->neg ^ b->neg;
+    if (z == a || z == b) {
+        Big t;
+        big_init(&t);
+        big_mul(&t, &a->mag, &b->mag);
+        big_free(&z->mag);
+        z->mag = t;
+    } else {
+        big_mul(&z->mag, &a->mag, &b->mag);
+    }
+    z->neg = big_is_zero(&z->mag) ? 0 : neg;
+}
+
+static void sbig_add_signed(SBig* z, const SBig* a, const SBig* b, int bneg) {
+    int aneg = a->neg;
+    if (aneg == bneg) {
+        big_add(&z->mag, &a->mag, &b->mag);
+        z->neg = aneg;
+    } else if (big_cmp(&a->mag, &b->mag) >= 0) {
+        big_sub(&z->mag, &a->mag, &b->mag);
+        z->neg = aneg;
+    } else {
+        big_sub(&z->mag, &b->mag, &a->mag);
+        z->neg = bneg;
+    }
+    if (big_is_zero(&z->mag)) z->neg = 0;
+}
+
+static void sbig_add(SBig* z, const SBig* a, const SBig* b) {
+    sbig_add_signed(z, a, b, b->neg);
+}
+
+static void sbig_sub(SBig* z, const SBig* a, const SBig* b) {
+    sbig_add_signed(z, a, b, !b->neg && !big_is_zero(&b->mag));
+}
+
+static void sbig_print_hex(const SBig* x) {
+    if (x->neg) printf("-");
+    big_print_hex(&x->mag);
+}
+
+/* Binary floating point: value = mant * 2^exp, with mant truncated to
+   exactly prec bits (or zero). */
+typedef struct {
+    Big mant;
+    int64_t exp;
+    size_t prec;
+} BigFloat;
+
+static void bf_init(BigFloat* x, size_t prec) {
+    big_init(&x->mant);
+    big_zero(&x->mant);
+    x->exp = 0;
+    x->prec = prec;
+}
+
+static void bf_free(BigFloat* x) {
+    big_free(&x->mant);
+}
+
+static void bf_round(BigFloat* x) {
+    size_t bl = big_bitlen(&x->mant);
+    if (bl == 0) {
+        big_zero(&x->mant);
+        x->exp = 0;
+    } else if (bl > x->prec) {
+        big_shr(&x->mant, &x->mant, bl - x->prec);
+        x->exp += (int64_t)(bl - x->prec);
+    } else if (bl < x->prec) {
+        Big t;
+        big_init(&t);
+        size_t sh = x->prec - bl;
+        big_shl(&t, &x->mant, sh / 32, (unsigned)(sh % 32));
+        big_free(&x->mant);
+        x->mant = t;
+        x->exp -= (int64_t)sh;
+    }
+}
+
+static void bf_set_big(BigFloat* x, const Big* v, int64_t exp) {
+    big_copy(&x->mant, v);
+    x->exp = exp;
+    bf_round(x);
+}
+
+static void bf_set_u64(BigFloat* x, uint64_t v, int64_t exp) {
+    big_reserve(&x->mant, 2);
+    x->mant.d[0] = (uint32_t)v;
+    x->mant.d[1] = (uint32_t)(v >> 32);
+    x->mant.n = 2;
+    big_normalize(&x->mant);
+    x->exp = exp;
+    bf_round(x);
+}
+
+static int bf_is_zero(const BigFloat* x) {
+    return big_is_zero(&x->mant);
+}
+
+static void bf_mul(BigFloat* z, const BigFloat* a, const BigFloat* b) {
+    Big t;
+    big_init(&t);
+    size_t cut = big_mulhi(&t, &a->mant, &b->mant, (z->prec + 31) / 32 + 1);
+    big_free(&z->mant);
+    z->mant = t;
+    z->exp = a->exp + b->exp + (int64_t)cut * 32;
+    bf_round(z);
+}
+
+/* Shared by add and sub: z = a + b or z = a - b (the latter needs a >= b). */
+static void bf_addsub(BigFloat* z, const BigFloat* a, const BigFloat* b, int sub) {
+    if (bf_is_zero(b)) {
+        bf_set_big(z, &a->mant, a->exp);
+        return;
+    }
+    if (bf_is_zero(a)) {
+        bf_set_big(z, &b->mant, b->exp);
+        return;
+    }
+
+    const BigFloat* hi = a;
+    const BigFloat* lo = b;
+    int64_t ahi = a->exp + (int64_t)big_bitlen(&a->mant);
+    int64_t bhi = b->exp + (int64_t)big_bitlen(&b->mant);
+    if (!sub && bhi > ahi) { hi = b; lo = a; }
+
+    int64_t top = (hi == a) ? ahi : bhi;
+    int64_t floor_exp = top - (int64_t)z->prec - 64;
+    int64_t base = lo->exp > floor_exp ? lo->exp : floor_exp;
+    if (hi->exp < base) base = hi->exp;
+
+    Big x, y;
+    big_init(&x); big_init(&y);
+    big_shl(&x, &hi->mant, (size_t)(hi->exp - base) / 32, (unsigned)((hi->exp - base) % 32));
+    if (lo->exp >= base) {
+        big_shl(&y, &lo->mant, (size_t)(lo->exp - base) / 32, (unsigned)((lo->exp - base) % 32));
+    } else {
+        big_shr(&y, &lo->mant, (size_t)(base - lo->exp));
+    }
+
+    if (sub) big_sub(&z->mant, &x, &y);
+    else big_add(&z->mant, &x, &y);
+    z->exp = base;
+    bf_round(z);
+
+    big_free(&x); big_free(&y);
+}
+
+static void bf_add(BigFloat* z, const BigFloat* a, const BigFloat* b) {
+    bf_addsub(z, a, b, 0);
+}
+
+static void bf_sub(BigFloat* z, const BigFloat* a, const BigFloat* b) {
+    bf_addsub(z, a, b, 1);
+}
+
+/* Leading 52 bits of x as t * 2^e with t in [2^51, 2^52). */
+static uint64_t bf_top52(const BigFloat* x, int64_t* e) {
+    Big t;
+    big_init(&t);
+    size_t bl = big_bitlen(&x->mant);
+    if (bl > 52) {
+        big_shr(&t, &x->mant, bl - 52);
+        *e = x->exp + (int64_t)(bl - 52);
+    } else {
+        big_shl(&t, &x->mant, 0, (unsigned)(52 - bl));
+        *e = x->exp - (int64_t)(52 - bl);
+    }
+    uint64_t v = t.d[0] | (t.n > 1 ? (uint64_t)t.d[1] << 32 : 0);
+    big_free(&t);
+    return v;
+}
+
+/* Newton iteration r <- r * (2 - b * r), doubling the precision each step. */
+static int bf_recip(BigFloat* z, const BigFloat* b) {
+    if (bf_is_zero(b)) return 0;
+
+    size_t target = z->prec + 32;
+    int64_t e;
+    uint64_t t = bf_top52(b, &e);
+    BigFloat r, two, p;
+    bf_init(&r, 48); bf_init(&two, 2); bf_init(&p, 48);
+    bf_set_u64(&r, (uint64_t)(ldexp(1.0, 104) / (double)t), -104 - e);
+    bf_set_u64(&two, 2, 0);
+
+    size_t cur = 48;
+    while (cur < target) {
+        cur = (cur * 2 < target) ? cur * 2 : target;
+        r.prec = p.prec = cur + 32;
+        bf_mul(&p, b, &r);
+        bf_sub(&p, &two, &p);
+        bf_mul(&r, &r, &p);
+    }
+
+    big_copy(&z->mant, &r.mant);
+    z->exp = r.exp;
+    bf_round(z);
+    bf_free(&r); bf_free(&two); bf_free(&p);
+    return 1;
+}
+
+static int bf_div(BigFloat* z, const BigFloat* a, const BigFloat* b) {
+    BigFloat r;
+    bf_init(&r, z->prec + 32);
+    if (!bf_recip(&r, b)) {
+        bf_free(&r);
+        return 0;
+    }
+    bf_mul(z, a, &r);
+    bf_free(&r);
+    return 1;
+}
+
+/* Inverse square root by y <- y * (3 - a * y^2) / 2, then sqrt(a) = a * y. */
+static void bf_sqrt(BigFloat* z, const BigFloat* a) {
+    if (bf_is_zero(a)) {
+        big_zero(&z->mant);
+        z->exp = 0;
+        return;
+    }
+
+    size_t target = z->prec + 32;
+    int64_t e;
+    uint64_t t = bf_top52(a, &e);
+    if (e & 1) { t >>= 1; ++e; }
+    BigFloat y, three, p;
+    bf_init(&y, 48); bf_init(&three, 2); bf_init(&p, 48);
+    bf_set_u64(&y, (uint64_t)ldexp(1.0 / sqrt((double)t), 80), -80 - e / 2);
+    bf_set_u64(&three, 3, 0);
+
+    size_t cur = 48;
+    while (cur < target) {
+        cur = (cur * 2 < target) ? cur * 2 : target;
+        y.prec = p.prec = cur + 32;
+        bf_mul(&p, &y, &y);
+        bf_mul(&p, a, &p);
+        bf_sub(&p, &three, &p);
+        bf_mul(&y, &y, &p);
+        y.exp -= 1;
+    }
+
+    bf_mul(z, a, &y);
+    bf_free(&y); bf_free(&three); bf_free(&p);
+}
+
+/* Decimal-native variant: limbs in base 10^9 so that decimal input and
+   output are linear-time copies instead of base conversions. The sign is
+   kept beside the magnitude, as in SBig. */
+#define BIG_DEC_BASE 1000000000u
+#define BIG_DEC_DIGITS 9
+
+typedef struct {
+    Big v;
+    int neg;
+} BigDec;
+
+static void big_dec_init(BigDec* x) {
+    big_init(&x->v);
+    x->neg = 0;
+}
+
+static void big_dec_free(BigDec* x) {
+    big_free(&x->v);
+    x->neg = 0;
+}
+
+static int big_dec_from_str(BigDec* x, const char* s) {
+    big_zero(&x->v);
+    x->neg = 0;
+    while (isspace((unsigned char)*s)) ++s;
+    if (*s == '+') ++s;
+    else if (*s == '-') { x->neg = 1; ++s; }
+    const char* first = s;
+    while (isdigit((unsigned char)*s)) ++s;
+    const char* last = s;
+    if (first == last) return 0;
+    while (isspace((unsigned char)*s)) ++s;
+    if (*s != '\0') return 0;
+
+    size_t len = (size_t)(last - first);
+    size_t n = (len + BIG_DEC_DIGITS - 1) / BIG_DEC_DIGITS;
+    big_reserve(&x->v, n);
+    for (size_t i = 0; i < n; ++i) {
+        const char* end = last - i * BIG_DEC_DIGITS;
+        const char* p = (end - first > BIG_DEC_DIGITS) ? end - BIG_DEC_DIGITS : first;
+        uint32_t limb = 0;
+        for (; p < end; ++p) limb = limb * 10u + (uint32_t)(*p - '0');
+        x->v.d[i] = limb;
+    }
+    x->v.n = n;
+    big_normalize(&x->v);
+    if (x->v.n == 0) { big_zero(&x->v); x->neg = 0; }
+    return 1;
+}
+
+static void big_dec_mul_school(Big* z, const Big* a, const Big* b) {
+    size_t an = a->n, bn = b->n;
+    size_t rn = an + bn;
+
+    big_reserve(z, rn);
+    memset(z->d, 0, rn * sizeof(uint32_t));
+    z->n = rn;
+
+    for (size_t i = 0; i < an; ++i) {
+        uint64_t carry = 0;
+        uint64_t ai = a->d[i];
+        for (size_t j = 0; j < bn; ++j) {
+            uint64_t sum = (uint64_t)z->d[i + j] + ai * (uint64_t)b->d[j] + carry;
+            z->d[i + j] = (uint32_t)(sum % BIG_DEC_BASE);
+            carry = sum / BIG_DEC_BASE;
+        }
+        z->d[i + bn] = (uint32_t)carry;
+    }
+}
+
+static void big_dec_mul(BigDec* z, const BigDec* a, const BigDec* b) {
+    if ((a->v.n == 0) || (b->v.n == 0) ||
+        (a->v.n == 1 && a->v.d[0] == 0) ||
+        (b->v.n == 1 && b->v.d[0] == 0)) {
+        big_zero(&z->v);
+        z->neg = 0;
+        return;
+    }
+    z->neg = a->neg ^ b->neg;
+
+    if (a->v.n < BIG_NTT_THRESHOLD || b->v.n < BIG_NTT_THRESHOLD) {
+        big_dec_mul_school(&z->v, &a->v, &b->v);
+    } else {
+        big_reserve(&z->v, a->v.n + b->v.n);
+        ntt_mul_blocked(z->v.d, a->v.d, a->v.n, b->v.d, b->v.n, BIG_DEC_BASE);
+        z->v.n = a->v.n + b->v.n;
+    }
+
+    big_normalize(&z->v);
+    if (z->v.n == 0) big_zero(&z->v);
+}
+
+/* Predicted time of big_dec_mul under the binary cost model. */
+static double big_dec_mul_ns(size_t an, size_t bn) {
+    int tier = an < BIG_NTT_THRESHOLD || bn < BIG_NTT_THRESHOLD ? TIER_SCHOOL : TIER_NTT;
+    return big_tier_ns(tier, an, bn, 1);
+}
+
+static void big_dec_print(const BigDec* x) {
+    if (x->v.n == 0) {
+        puts("0");
+        return;
+    }
+    printf("%s%u", x->neg ? "-" : "", x->v.d[x->v.n - 1]);
+    for (size_t k = x->v.n - 1; k-- > 0; ) {
+        printf("%09u", x->v.d[k]);
+    }
+    puts("");
+}
+
+/* Lazy expression DAG. Builders return node ids and hash-cons identical
+   nodes (commutative operands in canonical order), so repeated
+   subexpressions are stored once; mul(x, x) becomes a square and pow
+   expands into a square-and-multiply chain over shared nodes. Operands
+   always have smaller ids than their users. Values are unsigned: a sub
+   whose result would be negative, or a division by zero, makes expr_eval
+   fail. */
+typedef enum { EXPR_LEAF, EXPR_ADD, EXPR_SUB, EXPR_MUL, EXPR_SQR, EXPR_FMA, EXPR_DIV, EXPR_MOD } ExprOp;
+
+typedef struct {
+    ExprOp op;
+    int a, b;
+    uint64_t key;
+    Big val;
+} ExprNode;
+
+typedef struct {
+    ExprNode* nodes;
+    size_t n, cap;
+    int* slots;
+    size_t nslots;
+} Expr;
+
+static void expr_init(Expr* e) {
+    e->nodes = NULL;
+    e->n = e->cap = 0;
+    e->slots = NULL;
+    e->nslots = 0;
+}
+
+static void expr_free(Expr* e) {
+    for (size_t i = 0; i < e->n; ++i) big_free(&e->nodes[i].val);
+    free(e->nodes);
+    free(e->slots);
+    expr_init(e);
+}
+
+static void expr_rehash(Expr* e, size_t nslots) {
+    int* s = (int*)malloc(nslots * sizeof(int));
+    if (!s) { perror("malloc"); exit(1); }
+    for (size_t i = 0; i < nslots; ++i) s[i] = -1;
+    for (size_t i = 0; i < e->n; ++i) {
+        size_t h = (size_t)e->nodes[i].key & (nslots - 1);
+        while (s[h] >= 0) h = (h + 1) & (nslots - 1);
+        s[h] = (int)i;
+    }
+    free(e->slots);
+    e->slots = s;
+    e->nslots = nslots;
+}
+
+static int expr_intern(Expr* e, ExprOp op, int a, int b, const Big* v) {
+    uint64_t key = v ? big_hash(v) : ((uint64_t)op << 56) ^ ((uint64_t)(uint32_t)a << 28) ^ (uint64_t)(uint32_t)b;
+    key = (key ^ (key >> 31)) * 0x9E3779B97F4A7C15ull;
+    if (2 * (e->n + 1) > e->nslots) expr_rehash(e, e->nslots ? 2 * e->nslots : 64);
+
+    size_t h = (size_t)key & (e->nslots - 1);
+    for (; e->slots[h] >= 0; h = (h + 1) & (e->nslots - 1)) {
+        const ExprNode* x = &e->nodes[e->slots[h]];
+        if (x->key != key || x->op != op) continue;
+        if (v ? big_cmp(&x->val, v) == 0 : (x->a == a && x->b == b)) return e->slots[h];
+    }
+
+    if (e->n == e->cap) {
+        size_t nc = e->cap ? 2 * e->cap : 16;
+        void* p = realloc(e->nodes, nc * sizeof(ExprNode));
+        if (!p) { perror("realloc"); exit(1); }
+        e->nodes = (ExprNode*)p;
+        e->cap = nc;
+    }
+    ExprNode* x = &e->nodes[e->n];
+    x->op = op;
+    x->a = a;
+    x->b = b;
+    x->key = key;
+    big_init(&x->val);
+    if (v) big_copy(&x->val, v);
+    e->slots[h] = (int)e->n;
+    return (int)e->n++;
+}
+
+static int expr_leaf(Expr* e, const Big* v) {
+    Big z;
+    if (v->n == 0) {
+        big_init(&z);
+        big_zero(&z);
+        int id = expr_intern(e, EXPR_LEAF, -1, -1, &z);
+        big_free(&z);
+        return id;
+    }
+    return expr_intern(e, EXPR_LEAF, -1, -1, v);
+}
+
+static int expr_add(Expr* e, int a, int b) {
+    return a < b ? expr_intern(e, EXPR_ADD, a, b, NULL) : expr_intern(e, EXPR_ADD, b, a, NULL);
+}
+
+static int expr_sub(Expr* e, int a, int b) {
+    return expr_intern(e, EXPR_SUB, a, b, NULL);
+}
+
+static int expr_div(Expr* e, int a, int b) {
+    return expr_intern(e, EXPR_DIV, a, b, NULL);
+}
+
+static int expr_mod(Expr* e, int a, int b) {
+    return expr_intern(e, EXPR_MOD, a, b, NULL);
+}
+
+static int expr_mul(Expr* e, int a, int b) {
+    if (a == b) return expr_intern(e, EXPR_SQR, a, a, NULL);
+    return a < b ? expr_intern(e, EXPR_MUL, a, b, NULL) : expr_intern(e, EXPR_MUL, b, a, NULL);
+}
+
+static int expr_pow(Expr* e, int a, uint64_t k) {
+    if (k == 0) {
+        Big one;
+        big_init(&one);
+        big_from_u64(&one, 1);
+        int id = expr_leaf(e, &one);
+        big_free(&one);
+        return id;
+    }
+    int r = -1;
+    for (;;) {
+        if (k & 1) r = r < 0 ? a : expr_mul(e, r, a);
+        k >>= 1;
+        if (!k) return r;
+        a = expr_mul(e, a, a);
+    }
+}
+
+/* Evaluation plan: the node's op after fusion, its operands (c is the
+   addend of a fused multiply-add) and the value computed for it. */
+typedef struct {
+    ExprOp op;
+    int a, b, c;
+    int uses;
+    int level;
+    Big val;
+} ExprStep;
+
+typedef struct {
+    const Expr* e;
+    ExprStep* steps;
+    const int* ids;
+    size_t count;
+    size_t next;
+    int failed;
+    BigMutex lock;
+    const BigExecutor* ex;
+} ExprLevel;
+
+static const Big* expr_value(const Expr* e, ExprStep* steps, int id) {
+    return e->nodes[id].op == EXPR_LEAF ? &e->nodes[id].val : &steps[id].val;
+}
+
+static int expr_step(const Expr* e, ExprStep* steps, int id, const BigExecutor* ex) {
+    ExprStep* s = &steps[id];
+    const Big* a = expr_value(e, steps, s->a);
+    const Big* b = expr_value(e, steps, s->b);
+    switch (s->op) {
+    case EXPR_ADD:
+        big_add(&s->val, a, b);
+        break;
+    case EXPR_SUB:
+        if (big_cmp(a, b) < 0) return 0;
+        big_sub(&s->val, a, b);
+        break;
+    case EXPR_MUL:
+    case EXPR_SQR:
+        big_mul_pooled(&s->val, a, b, ex);
+        break;
+    case EXPR_FMA:
+        big_mul_pooled(&s->val, a, b, ex);
+        big_add(&s->val, &s->val, expr_value(e, steps, s->c));
+        break;
+    case EXPR_DIV:
+        return big_divmod(&s->val, NULL, a, b);
+    case EXPR_MOD:
+        return big_divmod(NULL, &s->val, a, b);
+    default:
+        break;
+    }
+    return 1;
+}
+
+static void expr_level_worker(void* arg, size_t slice) {
+    ExprLevel* L = (ExprLevel*)arg;
+    (void)slice;
+    for (;;) {
+        big_mutex_lock(&L->lock);
+        size_t i = L->next++;
+        big_mutex_unlock(&L->lock);
+        if (i >= L->count) return;
+        if (!expr_step(L->e, L->steps, L->ids[i], L->ex)) {
+            big_mutex_lock(&L->lock);
+            L->failed = 1;
+            big_mutex_unlock(&L->lock);
+        }
+    }
+}
+
+typedef struct {
+    size_t cost;
+    int id;
+} ExprJob;
+
+static int expr_job_cmp(const void* x, const void* y) {
+    size_t a = ((const ExprJob*)x)->cost, b = ((const ExprJob*)y)->cost;
+    return a < b ? 1 : a > b ? -1 : 0;
+}
+
+static size_t expr_cost(const Expr* e, ExprStep* steps, int id) {
+    if (steps[id].op == EXPR_ADD || steps[id].op == EXPR_SUB) return 0;
+    return big_len(expr_value(e, steps, steps[id].a)) + big_len(expr_value(e, steps, steps[id].b));
+}
+
+/* Evaluates node `root` into z on the calling thread and the free workers
+   of ex (NULL: the caller alone). Only nodes reachable from root are
+   computed. An add whose operand is a product used nowhere else becomes
+   one multiply-add. Nodes are run in dependency levels; within a level the
+   multiplications are spread across workers, largest first, a lone large
+   product splits its transforms instead, and intermediate values are
+   released once their last user has run. Returns 0 if a sub went negative
+   or a divisor was zero. */
+static int expr_eval(const Expr* e, int root, Big* z, const BigExecutor* ex) {
+    if (root < 0 || (size_t)root >= e->n) return 0;
+    if (e->nodes[root].op == EXPR_LEAF) {
+        big_copy(z, &e->nodes[root].val);
+        return 1;
+    }
+
+    size_t n = (size_t)root + 1;
+    ExprStep* steps = (ExprStep*)calloc(n, sizeof(ExprStep));
+    char* need = (char*)calloc(n, 1);
+    int* ids = (int*)malloc(n * sizeof(int));
+    size_t* start = (size_t*)calloc(n + 1, sizeof(size_t));
+    if (!steps || !need || !ids || !start) { perror("calloc"); exit(1); }
+
+    need[root] = 1;
+    for (size_t i = n; i-- > 0; ) {
+        const ExprNode* x = &e->nodes[i];
+        ExprStep* s = &steps[i];
+        big_init(&s->val);
+        s->op = x->op;
+        s->a = x->a;
+        s->b = x->b;
+        s->c = -1;
+        if (!need[i] || x->op == EXPR_LEAF) continue;
+        need[x->a] = need[x->b] = 1;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (!need[i] || steps[i].op == EXPR_LEAF) continue;
+        ++steps[steps[i].a].uses;
+        if (steps[i].b != steps[i].a) ++steps[steps[i].b].uses;
+    }
+
+    /* Fuse add(product, c) when nothing else reads the product. */
+    for (size_t i = 0; i < n; ++i) {
+        ExprStep* s = &steps[i];
+        if (!need[i] || s->op != EXPR_ADD) continue;
+        for (int side = 0; side < 2; ++side) {
+            int m = side ? s->b : s->a, c = side ? s->a : s->b;
+            ExprStep* p = &steps[m];
+            if ((p->op != EXPR_MUL && p->op != EXPR_SQR) || p->uses != 1 || m == c) continue;
+            s->op = EXPR_FMA;
+            s->a = p->a;
+            s->b = p->b;
+            s->c = c;
+            need[m] = 0;
+            break;
+        }
+    }
+
+    int top = 0;
+    for (size_t i = 0; i < n; ++i) {
+        ExprStep* s = &steps[i];
+        if (!need[i] || s->op == EXPR_LEAF) continue;
+        int l = steps[s->a].level > steps[s->b].level ? steps[s->a].level : steps[s->b].level;
+        if (s->c >= 0 && steps[s->c].level > l) l = steps[s->c].level;
+        s->level = l + 1;
+        if (s->level > top) top = s->level;
+        ++start[s->level];
+    }
+    for (int l = 1; l <= top; ++l) start[l] += start[l - 1];
+    start[top + 1] = start[top];
+    for (size_t i = n; i-- > 0; ) {
+        if (need[i] && steps[i].op != EXPR_LEAF) ids[--start[steps[i].level]] = (int)i;
+    }
+
+    int ok = 1;
+    for (int l = 1; l <= top && ok; ++l) {
+        int* lv = ids + start[l];
+        size_t count = start[l + 1] - start[l];
+        ExprJob* jobs = (ExprJob*)malloc(count * sizeof(ExprJob));
+        if (!jobs) { perror("malloc"); exit(1); }
+        size_t heavy = 0;
+        for (size_t i = 0; i < count; ++i) {
+            jobs[i].id = lv[i];
+            jobs[i].cost = expr_cost(e, steps, lv[i]);
+            if (jobs[i].cost >= 2 * BIG_NTT_THRESHOLD) ++heavy;
+        }
+        qsort(jobs, count, sizeof(ExprJob), expr_job_cmp);
+        for (size_t i = 0; i < count; ++i) lv[i] = jobs[i].id;
+        free(jobs);
+
+        ExprLevel L;
+        L.e = e;
+        L.steps = steps;
+        L.ids = lv;
+        L.count = count;
+        L.next = 0;
+        L.failed = 0;
+        L.ex = ex;
+        big_mutex_init(&L.lock);
+        size_t slices = 1 + big_exec_size(ex);
+        if (heavy < slices) slices = heavy ? heavy : 1;
+        big_exec_for(ex, slices, expr_level_worker, &L);
+        big_mutex_destroy(&L.lock);
+        ok = !L.failed;
+
+        for (size_t i = 0; i < count; ++i) {
+            const ExprStep* s = &steps[lv[i]];
+            int ops[3] = { s->a, s->b, s->c };
+            for (int k = 0; k < 3; ++k) {
+                if (ops[k] < 0 || (k == 1 && ops[1] == ops[0])) continue;
+                if (--steps[ops[k]].uses == 0) big_free(&steps[ops[k]].val);
+            }
+        }
+    }
+
+    if (ok) big_copy(z, &steps[root].val);
+    for (size_t i = 0; i < n; ++i) big_free(&steps[i].val);
+    free(steps);
+    free(need);
+    free(ids);
+    free(start);
+    return ok;
+}
+
+static int run_dec_job(const char* a_str, const char* b_str) {
+    BigDec A, B, C;
+    big_dec_init(&A); big_dec_init(&B); big_dec_init(&C);
+
+    if (!big_dec_from_str(&A, a_str) || !big_dec_from_str(&B, b_str)) {
+        fprintf(stderr, "Invalid input. Please enter decimal digits only.\n");
+        big_dec_free(&A); big_dec_free(&B); big_dec_free(&C);
+        return 1;
+    }
+
+    big_dec_mul(&C, &A, &B);
+
+    printf("Result (dec): ");
+    big_dec_print(&C);
+
+    big_dec_free(&A); big_dec_free(&B); big_dec_free(&C);
+    return 0;
+}
+
+/* Opens the --bin target: a file, or stdout in binary mode for "-". */
+static FILE* big_bin_open(const char* path) {
+    if (strcmp(path, "-") != 0) {
+        FILE* f = fopen(path, "wb");
+        if (!f) perror(path);
+        return f;
+    }
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    return stdout;
+}
+
+/* --bin: |a * b| streamed as raw limbs to a file, or to stdout for "-";
+   the summary then goes to stderr to keep the stream clean. */
+static int run_bin_job(const char* a_str, const char* b_str, const char* path) {
+    SBig A, B;
+    sbig_init(&A); sbig_init(&B);
+
+    if (!sbig_from_dec(&A, a_str) || !sbig_from_dec(&B, b_str)) {
+        fprintf(stderr, "Invalid input. Please enter decimal digits only.\n");
+        sbig_free(&A); sbig_free(&B);
+        return 1;
+    }
+
+    FILE* f = big_bin_open(path);
+    if (!f) {
+        sbig_free(&A); sbig_free(&B);
+        return 1;
+    }
+    int to_stdout = f == stdout;
+    BigSink sink;
+    big_sink_init(&sink, f);
+    int ok = big_mul_to_sink(&A.mag, &B.mag, &sink);
+    if (!to_stdout && fclose(f) != 0) ok = 0;
+    int neg = A.neg != B.neg && !big_is_zero(&A.mag) && !big_is_zero(&B.mag);
+
+    if (!ok) fprintf(stderr, "Write error.\n");
+    else fprintf(to_stdout ? stderr : stdout, "Result (binary): %llu limbs%s\n",
+        (unsigned long long)sink.limbs, neg ? ", negative" : "");
+
+    sbig_free(&A); sbig_free(&B);
+    return ok ? 0 : 1;
+}
+
+/* Script mode. Each statement is `name = expr` or a bare `expr`, whose
+   value is printed; statements end at a newline or ';' and '#' starts a
+   comment. Expressions use + - * / mod ^ and parentheses, decimal
+   literals, variables and the functions sqr(x), pow(x, k), fact(n),
+   bits(x) and digits(x). Every statement is built as one expression DAG,
+   so repeated subterms are computed once, and variables keep their
+   values in binary between statements. With --bin, bare values go to the
+   sink as raw limbs instead, and a bare product is streamed from its two
+   operands without ever holding the result. */
+typedef struct {
+    char* name;
+    Big val;
+} ScriptVar;
+
+typedef struct {
+    const char* p;
+    Expr e;
+    ScriptVar* vars;
+    size_t nvars, cap;
+    const char* err;
+    const BigExecutor* ex;
+    BigSink* bin;
+    FILE* note;      /* where the --bin summaries go */
+} Script;
+
+static void script_skip(Script* s) {
+    while (*s->p == ' ' || *s->p == '\t' || *s->p == '\r') ++s->p;
+    if (*s->p == '#') s->p += strlen(s->p);
+}
+
+static int script_accept(Script* s, char c) {
+    script_skip(s);
+    if (*s->p != c) return 0;
+    ++s->p;
+    return 1;
+}
+
+static size_t script_ident(Script* s) {
+    script_skip(s);
+    size_t n = 0;
+    if (!isalpha((unsigned char)s->p[0]) && s->p[0] != '_') return 0;
+    while (isalnum((unsigned char)s->p[n]) || s->p[n] == '_') ++n;
+    return n;
+}
+
+static ScriptVar* script_var(Script* s, const char* name, size_t len) {
+    for (size_t i = 0; i < s->nvars; ++i) {
+        if (strlen(s->vars[i].name) == len && memcmp(s->vars[i].name, name, len) == 0) return &s->vars[i];
+    }
+    return NULL;
+}
+
+static int script_fail(Script* s, const char* msg) {
+    if (!s->err) s->err = msg;
+    return -1;
+}
+
+/* Evaluates a node right away, for arguments that must be known while
+   the DAG is still being built (exponents and function arguments). */
+static int script_now_u64(Script* s, int id, uint64_t* v) {
+    Big t;
+    big_init(&t);
+    int ok = expr_eval(&s->e, id, &t, s->ex) && big_to_u64(&t, v);
+    big_free(&t);
+    return ok;
+}
+
+static int script_u64(Script* s, uint64_t v) {
+    Big t;
+    big_init(&t);
+    big_from_u64(&t, v);
+    int id = expr_leaf(&s->e, &t);
+    big_free(&t);
+    return id;
+}
+
+/* Product lo * (lo + 1) * ... * hi as a balanced tree of DAG nodes. */
+static int script_range(Script* s, uint64_t lo, uint64_t hi) {
+    if (hi - lo < 16) {
+        Big p, t, f;
+        big_init(&p); big_init(&t); big_init(&f);
+        big_from_u64(&p, 1);
+        for (uint64_t i = lo; i <= hi; ++i) {
+            big_from_u64(&f, i);
+            big_mul(&t, &p, &f);
+            big_copy(&p, &t);
+        }
+        int id = expr_leaf(&s->e, &p);
+        big_free(&p); big_free(&t); big_free(&f);
+        return id;
+    }
+    uint64_t mid = lo + (hi - lo) / 2;
+    int a = script_range(s, lo, mid);
+    int b = script_range(s, mid + 1, hi);
+    return expr_mul(&s->e, a, b);
+}
+
+static int script_expr(Script* s);
+
+static int script_call(Script* s, const char* name, size_t len) {
+    int args[2], n = 0;
+    if (!script_accept(s, ')')) {
+        do {
+            if (n == 2) return script_fail(s, "too many arguments");
+            if ((args[n++] = script_expr(s)) < 0) return -1;
+        } while (script_accept(s, ','));
+        if (!script_accept(s, ')')) return script_fail(s, "expected ')'");
+    }
+
+    uint64_t k;
+    Big t;
+    if (len == 3 && memcmp(name, "sqr", 3) == 0 && n == 1) return expr_mul(&s->e, args[0], args[0]);
+    if (len == 3 && memcmp(name, "pow", 3) == 0 && n == 2) {
+        if (!script_now_u64(s, args[1], &k)) return script_fail(s, "exponent must fit in 64 bits");
+        return expr_pow(&s->e, args[0], k);
+    }
+    if (len == 4 && memcmp(name, "fact", 4) == 0 && n == 1) {
+        if (!script_now_u64(s, args[0], &k) || k > 100000000) return script_fail(s, "fact argument too large");
+        return k < 2 ? script_u64(s, 1) : script_range(s, 2, k);
+    }
+    if ((len == 4 && memcmp(name, "bits", 4) == 0 && n == 1) ||
+        (len == 6 && memcmp(name, "digits", 6) == 0 && n == 1)) {
+        big_init(&t);
+        if (!expr_eval(&s->e, args[0], &t, s->ex)) {
+            big_free(&t);
+            return script_fail(s, "negative result or division by zero");
+        }
+        k = len == 4 ? big_bitlen(&t) : big_dec_digits(&t);
+        big_free(&t);
+        return script_u64(s, k);
+    }
+    return script_fail(s, "unknown function or wrong argument count");
+}
+
+static int script_primary(Script* s) {
+    script_skip(s);
+    if (script_accept(s, '(')) {
+        int id = script_expr(s);
+        if (id >= 0 && !script_accept(s, ')')) return script_fail(s, "expected ')'");
+        return id;
+    }
+    if (isdigit((unsigned char)*s->p)) {
+        size_t n = 0;
+        while (isdigit((unsigned char)s->p[n])) ++n;
+        char* lit = (char*)malloc(n + 1);
+        if (!lit) { perror("malloc"); exit(1); }
+        memcpy(lit, s->p, n);
+        lit[n] = '\0';
+        s->p += n;
+        Big v;
+        big_init(&v);
+        big_from_dec(&v, lit);
+        int id = expr_leaf(&s->e, &v);
+        big_free(&v);
+        free(lit);
+        return id;
+    }
+    size_t n = script_ident(s);
+    if (n == 0) return script_fail(s, "expected a number, variable or '('");
+    const char* name = s->p;
+    s->p += n;
+    if (script_accept(s, '(')) return script_call(s, name, n);
+    ScriptVar* v = script_var(s, name, n);
+    if (!v) return script_fail(s, "undefined variable");
+    return expr_leaf(&s->e, &v->val);
+}
+
+static int script_power(Script* s) {
+    int base = script_primary(s);
+    if (base < 0 || !script_accept(s, '^')) return base;
+    int ex = script_power(s);
+    uint64_t k;
+    if (ex < 0) return -1;
+    if (!script_now_u64(s, ex, &k)) return script_fail(s, "exponent must fit in 64 bits");
+    return expr_pow(&s->e, base, k);
+}
+
+static int script_term(Script* s) {
+    int a = script_power(s);
+    while (a >= 0) {
+        script_skip(s);
+        char op = *s->p;
+        if (op == '*' || op == '/') {
+            ++s->p;
+        } else if (strncmp(s->p, "mod", 3) == 0 && !isalnum((unsigned char)s->p[3]) && s->p[3] != '_') {
+            s->p += 3;
+        } else {
+            break;
+        }
+        int b = script_power(s);
+        if (b < 0) return -1;
+        a = op == '*' ? expr_mul(&s->e, a, b) : op == '/' ? expr_div(&s->e, a, b) : expr_mod(&s->e, a, b);
+    }
+    return a;
+}
+
+static int script_expr(Script* s) {
+    int a = script_term(s);
+    while (a >= 0) {
+        if (script_accept(s, '+')) {
+            int b = script_term(s);
+            if (b < 0) return -1;
+            a = expr_add(&s->e, a, b);
+        } else if (script_accept(s, '-')) {
+            int b = script_term(s);
+            if (b < 0) return -1;
+            a = expr_sub(&s->e, a, b);
+        } else {
+            break;
+        }
+    }
+    return a;
+}
+
+/* Runs one statement starting at s->p; returns 0 on error (s->err set). */
+static int script_statement(Script* s, int dec_out) {
+    const char* name = NULL;
+    size_t len = script_ident(s);
+    if (len) {
+        const char* q = s->p + len;
+        while (*q == ' ' || *q == '\t') ++q;
+        if (*q == '=') {
+            name = s->p;
+            s->p = q + 1;
+        }
+    }
+
+    expr_init(&s->e);
+    int root = script_expr(s);
+    script_skip(s);
+    if (root >= 0 && *s->p && *s->p != ';' && *s->p != '\n') root = script_fail(s, "unexpected character");
+
+    Big v, w;
+    big_init(&v);
+    big_init(&w);
+    const Big* other = NULL;
+    if (root >= 0 && !name && s->bin && (s->e.nodes[root].op == EXPR_MUL || s->e.nodes[root].op == EXPR_SQR)) {
+        int a = s->e.nodes[root].a, b = s->e.nodes[root].b;
+        other = b == a ? &v : &w;
+        if (!expr_eval(&s->e, a, &v, s->ex) || (b != a && !expr_eval(&s->e, b, &w, s->ex)))
+            root = script_fail(s, "negative result or division by zero");
+    } else if (root >= 0 && !expr_eval(&s->e, root, &v, s->ex)) {
+        root = script_fail(s, "negative result or division by zero");
+    }
+    expr_free(&s->e);
+    if (root < 0) {
+        big_free(&v);
+        big_free(&w);
+        return 0;
+    }
+
+    if (!name && s->bin) {
+        uint64_t start = s->bin->limbs;
+        int ok;
+        if (other) {
+            ok = big_mul_to_sink(&v, other, s->bin);
+        } else {
+            uint32_t zero = 0;
+            if (big_len(&v)) big_sink_put(s->bin, v.d, big_len(&v));
+            else big_sink_put(s->bin, &zero, 1);
+            big_sink_flush(s->bin);
+            ok = s->bin->ok && fflush(s->bin->f) == 0;
+        }
+        big_free(&v);
+        big_free(&w);
+        if (!ok) {
+            script_fail(s, "write error");
+            return 0;
+        }
+        fprintf(s->note, "Result (binary): %llu limbs\n", (unsigned long long)(s->bin->limbs - start));
+        return 1;
+    }
+    if (!name) {
+        if (dec_out) big_print_dec(&v);
+        else big_print_hex(&v);
+        big_free(&v);
+        return 1;
+    }
+    ScriptVar* var = script_var(s, name, len);
+    if (!var) {
+        if (s->nvars == s->cap) {
+            size_t nc = s->cap ? 2 * s->cap : 8;
+            void* p = realloc(s->vars, nc * sizeof(ScriptVar));
+            if (!p) { perror("realloc"); exit(1); }
+            s->vars = (ScriptVar*)p;
+            s->cap = nc;
+        }
+        var = &s->vars[s->nvars++];
+        var->name = (char*)malloc(len + 1);
+        if (!var->name) { perror("malloc"); exit(1); }
+        memcpy(var->name, name, len);
+        var->name[len] = '\0';
+        big_init(&var->val);
+    }
+    big_free(&var->val);
+    var->val = v;
+    return 1;
+}
+
+/* Reads one line of any length; returns 0 at end of input. */
+static int script_read_line(FILE* f, char** buf, size_t* cap) {
+    size_t n = 0;
+    for (;;) {
+        if (n + 2 > *cap) {
+            size_t nc = *cap ? 2 * *cap : 4096;
+            void* p = realloc(*buf, nc);
+            if (!p) { perror("realloc"); exit(1); }
+            *buf = (char*)p;
+            *cap = nc;
+        }
+        if (!fgets(*buf + n, (int)(*cap - n > 0x7fffffff ? 0x7fffffff : *cap - n), f)) return n > 0;
+        n += strlen(*buf + n);
+        if (n > 0 && (*buf)[n - 1] == '\n') return 1;
+    }
+}
+
+static int run_script(const char* path, int dec_out, const char* bin_out) {
+    FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+
+    Script s;
+    memset(&s, 0, sizeof(s));
+    BigSink sink;
+    if (bin_out) {
+        FILE* out = big_bin_open(bin_out);
+        if (!out) {
+            if (f != stdin) fclose(f);
+            return 1;
+        }
+        big_sink_init(&sink, out);
+        s.bin = &sink;
+        s.note = out == stdout ? stderr : stdout;
+    }
+    /* The calling thread evaluates too, so the pool gets one worker less. */
+    BigPool pool;
+    BigExecutor own;
+    unsigned cores = big_affinity.n ? big_affinity.n : big_cpu_count();
+    s.ex = big_executor;
+    if (!s.ex && cores > 1) {
+        big_pool_start(&pool, cores - 1);
+        big_pool_executor(&own, &pool);
+        s.ex = &own;
+    }
+    char* line = NULL;
+    size_t cap = 0;
+    int lineno = 0, rc = 0;
+    while (!rc && script_read_line(f, &line, &cap)) {
+        ++lineno;
+        s.p = line;
+        for (;;) {
+            script_skip(&s);
+            if (*s.p == '\n' || *s.p == '\0') break;
+            if (*s.p == ';') {
+                ++s.p;
+                continue;
+            }
+            s.err = NULL;
+            if (!script_statement(&s, dec_out)) {
+                fprintf(stderr, "%s:%d: %s\n", path, lineno, s.err);
+                rc = 1;
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < s.nvars; ++i) {
+        free(s.vars[i].name);
+        big_free(&s.vars[i].val);
+    }
+    free(s.vars);
+    free(line);
+    if (f != stdin) fclose(f);
+    if (s.ex == &own) big_pool_stop(&pool);
+    if (s.bin && sink.f != stdout && fclose(sink.f) != 0 && !rc) {
+        fprintf(stderr, "Write error.\n");
+        rc = 1;
+    }
+    return rc;
+}
+
+/* Batch mode (--batch FILE, "-" for stdin; fed through a pipe it also
+   serves as a long-running daemon). Each line holds two decimal operands,
+   and results are printed as "#line value" in completion order, since
+   jobs finish out of order. Jobs are classed by predicted cost into small,
+   medium and large queues and run on big_executor, or on a built-in pool
+   with a worker per core. Each queued job submits one task that runs the
+   best job queued when it starts, so the queues keep their order under
+   any executor. Small and medium jobs submit urgent tasks, which the
+   built-in pool runs before helping the internal loops of running jobs.
+   Large jobs are taken only after that, and at most 1/BIG_SCHED_LARGE_DIV
+   of the workers run one at a time, so a huge product does not hold up
+   the small jobs queued behind it; a large job that finishes submits a
+   task for the next one. A large job spreads its transforms over
+   whichever workers are free (big_mul_pooled), so it uses the whole
+   machine when the queues are empty and runs alone when they are busy.
+   Operands are parsed by the worker that runs the job, and the class is
+   predicted from the digit counts, so a huge line does not stall the
+   reader either. An optional third field (or --deadline) gives a latency
+   deadline in milliseconds, counted from enqueue; a job whose product
+   the cost model says cannot finish in the time left is answered at once
+   with "#line ! deadline" and the estimate instead of being computed. A
+   queue head that has waited longer than BIG_SCHED_AGING_NS is served
+   first, which bounds starvation. Per-class latency, from enqueue to
+   completion, is reported on stderr at the end. */
+#define BIG_SCHED_SMALL_COST 1e6
+#define BIG_SCHED_LARGE_COST 1e9
+#define BIG_SCHED_LARGE_DIV 4
+#define BIG_SCHED_AGING_NS 200000000ull
+
+enum { SCHED_SMALL, SCHED_MEDIUM, SCHED_LARGE, SCHED_CLASSES };
+
+static const char* const sched_class_name[SCHED_CLASSES] = { "small", "medium", "large" };
+
+/* Predicted cost in limb operations: the schoolbook product below the NTT
+   threshold, otherwise three primes times three transforms. */
+static double big_mul_cost(size_t an, size_t bn) {
+    if (an < BIG_NTT_THRESHOLD || bn < BIG_NTT_THRESHOLD) return (double)an * (double)bn;
+    size_t m = 1;
+    unsigned lg = 0;
+    while (m < an + bn) {
+        m <<= 1;
+        ++lg;
+    }
+    return 9.0 * (double)m * lg;
+}
+
+typedef struct BigJob {
+    struct BigJob* next;
+    unsigned long line;
+    char* text;            /* the line, split into the two operands */
+    const char* a;
+    const char* b;
+    int cls;
+    uint64_t queued;
+    uint64_t deadline_ns;  /* 0 for none */
+} BigJob;
+
+typedef struct {
+    BigMutex lock;         /* guards the queues and the task count */
+    BigCond idle;
+    BigJob* head[SCHED_CLASSES];
+    BigJob* tail[SCHED_CLASSES];
+    const BigExecutor* ex;
+    size_t tasks;          /* submitted and not yet finished */
+    unsigned large_running, large_slots;
+    int dec_out;
+    const char* path;
+    int failed;
+    size_t missed;
+    BigMutex out_lock;     /* output and the latency samples */
+    uint64_t* lat[SCHED_CLASSES];
+    size_t nlat[SCHED_CLASSES], caplat[SCHED_CLASSES];
+} BigSched;
+
+/* Called with the lock held. */
+static BigJob* sched_take(BigSched* s, int urgent) {
+    int large_ok = s->head[SCHED_LARGE] && s->large_running < s->large_slots;
+    int cls = -1;
+    uint64_t now = big_now_ns();
+    for (int c = 0; c < SCHED_CLASSES && cls < 0; ++c) {
+        if (s->head[c] && (c != SCHED_LARGE || large_ok) && now - s->head[c]->queued > BIG_SCHED_AGING_NS) cls = c;
+    }
+    if (cls < 0 && s->head[SCHED_SMALL]) cls = SCHED_SMALL;
+    else if (cls < 0 && s->head[SCHED_MEDIUM]) cls = SCHED_MEDIUM;
+    else if (cls < 0 && !urgent && large_ok) cls = SCHED_LARGE;
+    if (cls < 0) return NULL;
+    BigJob* j = s->head[cls];
+    s->head[cls] = j->next;
+    if (!j->next) s->tail[cls] = NULL;
+    if (cls == SCHED_LARGE) ++s->large_running;
+    return j;
+}
+
+static void sched_task(void* arg);
+static void sched_task_urgent(void* arg);
+
+static void sched_push(BigSched* s, BigJob* j) {
+    j->next = NULL;
+    big_mutex_lock(&s->lock);
+    if (s->tail[j->cls]) s->tail[j->cls]->next = j;
+    else s->head[j->cls] = j;
+    s->tail[j->cls] = j;
+    ++s->tasks;
+    big_mutex_unlock(&s->lock);
+    int urgent = j->cls != SCHED_LARGE;
+    s->ex->submit(s->ex->ctx, urgent ? sched_task_urgent : sched_task, s, urgent);
+}
+
+/* With --dec a job stays in base 10^9 from parse to print (BigDec), so
+   neither end pays a quadratic base conversion; the product then runs on
+   the calling worker alone. */
+static void sched_run(BigSched* s, BigJob* j) {
+    SBig a, b, r;
+    BigDec da, db, dr;
+    sbig_init(&a);
+    sbig_init(&b);
+    sbig_init(&r);
+    big_dec_init(&da);
+    big_dec_init(&db);
+    big_dec_init(&dr);
+    int ok = s->dec_out ? big_dec_from_str(&da, j->a) && big_dec_from_str(&db, j->b)
+                        : sbig_from_dec(&a, j->a) && sbig_from_dec(&b, j->b);
+    int met = 1;
+    uint64_t est = 0, left = 0;
+    if (ok && j->deadline_ns) {
+        uint64_t waited = big_now_ns() - j->queued;
+        left = waited < j->deadline_ns ? j->deadline_ns - waited : 0;
+    }
+    if (ok && s->dec_out) {
+        if (j->deadline_ns) {
+            est = (uint64_t)big_dec_mul_ns(da.v.n, db.v.n);
+            met = est <= left;
+        }
+        if (met) big_dec_mul(&dr, &da, &db);
+    } else if (ok && j->deadline_ns) {
+        met = big_mul_deadline(&r.mag, &a.mag, &b.mag, left, s->ex, &est);
+    } else if (ok) {
+        big_mul_pooled(&r.mag, &a.mag, &b.mag, s->ex);
+    }
+    if (ok) r.neg = big_is_zero(&r.mag) ? 0 : a.neg ^ b.neg;
+    if (j->cls == SCHED_LARGE) {
+        big_mutex_lock(&s->lock);
+        --s->large_running;
+        int more = s->head[SCHED_LARGE] != NULL;
+        if (more) ++s->tasks;
+        big_mutex_unlock(&s->lock);
+        if (more) s->ex->submit(s->ex->ctx, sched_task, s, 0);
+    }
+
+    big_mutex_lock(&s->out_lock);
+    if (!ok) {
+        fprintf(stderr, "%s:%lu: expected two decimal numbers\n", s->path, j->line);
+        s->failed = 1;
+    } else if (!met) {
+        printf("#%lu ! deadline %.3f ms, estimated %.3f ms\n", j->line, (double)j->deadline_ns / 1e6, (double)est / 1e6);
+        fflush(stdout);
+        ++s->missed;
+    } else {
+        printf("#%lu ", j->line);
+        if (s->dec_out) {
+            big_dec_print(&dr);
+        } else {
+            sbig_print_hex(&r);
+        }
+        fflush(stdout);
+        int c = j->cls;
+        if (s->nlat[c] == s->caplat[c]) {
+            size_t nc = s->caplat[c] ? 2 * s->caplat[c] : 64;
+            void* q = realloc(s->lat[c], nc * sizeof(uint64_t));
+            if (!q) { perror("realloc"); exit(1); }
+            s->lat[c] = (uint64_t*)q;
+            s->caplat[c] = nc;
+        }
+        s->lat[c][s->nlat[c]++] = big_now_ns() - j->queued;
+    }
+    big_mutex_unlock(&s->out_lock);
+    free(j->text);
+    free(j);
+    sbig_free(&a);
+    sbig_free(&b);
+    sbig_free(&r);
+    big_dec_free(&da);
+    big_dec_free(&db);
+    big_dec_free(&dr);
+}
+
+/* Runs the best job queued right now. A task whose own job was taken by
+   an earlier task takes whatever is left, so no job is left without a
+   task; one may find nothing and return. */
+static void sched_drain(BigSched* s, int urgent) {
+    big_mutex_lock(&s->lock);
+    BigJob* j = sched_take(s, urgent);
+    if (!j && urgent) j = sched_take(s, 0);
+    big_mutex_unlock(&s->lock);
+    if (j) sched_run(s, j);
+    big_mutex_lock(&s->lock);
+    if (--s->tasks == 0) big_cond_broadcast(&s->idle);
+    big_mutex_unlock(&s->lock);
+}
+
+static void sched_task(void* arg) {
+    sched_drain((BigSched*)arg, 0);
+}
+
+static void sched_task_urgent(void* arg) {
+    sched_drain((BigSched*)arg, 1);
+}
+
+static int sched_cmp_u64(const void* x, const void* y) {
+    uint64_t a = *(const uint64_t*)x, b = *(const uint64_t*)y;
+    return (a > b) - (a < b);
+}
+
+static void sched_report(BigSched* s, FILE* f) {
+    for (int c = 0; c < SCHED_CLASSES; ++c) {
+        size_t n = s->nlat[c];
+        if (!n) continue;
+        uint64_t* l = s->lat[c];
+        qsort(l, n, sizeof(uint64_t), sched_cmp_u64);
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) sum += (double)l[i];
+        fprintf(f, "%s: %zu jobs, latency mean %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+            sched_class_name[c], n, sum / (double)n / 1e6, (double)l[n / 2] / 1e6,
+            (double)l[(n * 99) / 100] / 1e6, (double)l[n - 1] / 1e6);
+    }
+}
+
+/* Splits "a b [deadline]" in place into its fields; *c is empty when the
+   deadline is absent. */
+static int sched_split(char* line, const char** a, const char** b, const char** c) {
+    const char** field[3] = { a, b, c };
+    char* p = line;
+    for (int i = 0; i < 3; ++i) {
+        while (*p == ' ' || *p == '\t') ++p;
+        *field[i] = p;
+        while (*p && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') ++p;
+        if (*p) *p++ = '\0';
+    }
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') ++p;
+    return **a && **b && !*p;
+}
+
+static int run_batch(const char* path, int dec_out, double deadline_ms) {
+    FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+
+    BigSched s;
+    memset(&s, 0, sizeof(s));
+    big_mutex_init(&s.lock);
+    big_cond_init(&s.idle);
+    big_mutex_init(&s.out_lock);
+    s.dec_out = dec_out;
+    s.path = path;
+    BigPool pool;
+    BigExecutor own;
+    s.ex = big_executor;
+    if (!s.ex) {
+        big_pool_start(&pool, big_affinity.n ? big_affinity.n : big_cpu_count());
+        big_pool_executor(&own, &pool);
+        s.ex = &own;
+    }
+    unsigned workers = big_exec_size(s.ex);
+    s.large_slots = workers / BIG_SCHED_LARGE_DIV ? workers / BIG_SCHED_LARGE_DIV : 1;
+
+    char* line = NULL;
+    size_t cap = 0;
+    unsigned long lineno = 0;
+    int rc = 0;
+    while (script_read_line(f, &line, &cap)) {
+        ++lineno;
+        char* p = line;
+        while (*p == ' ' || *p == '\t') ++p;
+        if (*p == '\n' || *p == '\r' || *p == '\0' || *p == '#') continue;
+        BigJob* j = (BigJob*)malloc(sizeof(BigJob));
+        size_t len = strlen(p);
+        char* text = (char*)malloc(len + 1);
+        if (!j || !text) { perror("malloc"); exit(1); }
+        memcpy(text, p, len + 1);
+        j->text = text;
+        const char* dl;
+        char* end = NULL;
+        double ms = deadline_ms;
+        int ok = sched_split(text, &j->a, &j->b, &dl);
+        if (ok && *dl) {
+            ms = strtod(dl, &end);
+            ok = *end == '\0' && ms > 0;
+        }
+        if (!ok) {
+            fprintf(stderr, "%s:%lu: expected two decimal numbers and an optional deadline\n", path, lineno);
+            free(text);
+            free(j);
+            rc = 1;
+            continue;
+        }
+        /* 32 / log2(10) digits per limb */
+        double cost = big_mul_cost(strlen(j->a) * 10 / 96 + 1, strlen(j->b) * 10 / 96 + 1);
+        j->cls = cost < BIG_SCHED_SMALL_COST ? SCHED_SMALL : cost < BIG_SCHED_LARGE_COST ? SCHED_MEDIUM : SCHED_LARGE;
+        j->line = lineno;
+        j->deadline_ns = ms > 0 ? (uint64_t)(ms * 1e6) : 0;
+        j->queued = big_now_ns();
+        sched_push(&s, j);
+    }
+    free(line);
+    if (f != stdin) fclose(f);
+
+    big_mutex_lock(&s.lock);
+    while (s.tasks) big_cond_wait(&s.idle, &s.lock);
+    big_mutex_unlock(&s.lock);
+    if (s.ex == &own) big_pool_stop(&pool);
+
+    fflush(stdout);
+    sched_report(&s, stderr);
+    if (s.missed) fprintf(stderr, "deadline: %zu jobs refused\n", s.missed);
+    if (s.failed) rc = 1;
+    for (int c = 0; c < SCHED_CLASSES; ++c) free(s.lat[c]);
+    big_mutex_destroy(&s.out_lock);
+    big_cond_destroy(&s.idle);
+    big_mutex_destroy(&s.lock);
+    return rc;
+}
+
+/* --selftest: checks paths that the other modes cannot show to be right
+   against an independent computation, one line per check. Returns the
+   number of failed checks. */
+static uint64_t selftest_seed = 0x9e3779b97f4a7c15ull;
+
+static uint64_t selftest_next(void) {
+    selftest_seed ^= selftest_seed << 13;
+    selftest_seed ^= selftest_seed >> 7;
+    selftest_seed ^= selftest_seed << 17;
+    return selftest_seed;
+}
+
+static void selftest_random(Big* x, size_t n) {
+    big_reserve(x, n);
+    for (size_t i = 0; i < n; ++i) x->d[i] = (uint32_t)(selftest_next() >> 32);
+    x->n = n;
+    big_normalize(x);
+    if (x->n == 0) big_zero(x);
+}
+
+static int selftest_report(const char* what, int ok) {
+    printf("%-28s %s\n", what, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+/* The FFT's piece size rests on an a-priori error bound of 1/4. All-ones
+   operands put every piece at its largest value; the rounding error seen
+   there and on random operands must stay under the bound, and the product
+   must match the NTT. */
+static int selftest_fft(void) {
+    static const size_t sizes[] = { 64, 1000, 20000, 150000, 300000 };
+    int failed = 0;
+    Big a, b, z, r;
+    big_init(&a); big_init(&b); big_init(&z); big_init(&r);
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        size_t n = sizes[i];
+        for (int ones = 1; ones >= 0; --ones) {
+            if (ones) {
+                big_reserve(&a, n);
+                big_reserve(&b, n);
+                for (size_t k = 0; k < n; ++k) a.d[k] = b.d[k] = 0xFFFFFFFFu;
+                a.n = b.n = n;
+            } else {
+                selftest_random(&a, n);
+                selftest_random(&b, n);
+            }
+            unsigned bits, lg;
+            double err = 1;
+            int ok = fft_plan(a.n, b.n, &bits, &lg);
+            if (ok) {
+                big_reserve(&z, a.n + b.n);
+                ok = fft_mul_limbs(z.d, a.d, a.n, b.d, b.n, &err);
+                z.n = a.n + b.n;
+                big_normalize(&z);
+                big_mul_ntt(&r, &a, &b);
+                ok = ok && err < 0.25 && big_cmp(&z, &r) == 0;
+            }
+            char what[64];
+            snprintf(what, sizeof(what), "fft %zu limbs %s", n, ones ? "ones" : "random");
+            failed += selftest_report(what, ok);
+            if (ok) printf("    %u-bit pieces, 2^%u points, max rounding error %.3g (bound 0.25)\n", bits, lg, err);
+        }
+    }
+    big_free(&a); big_free(&b); big_free(&z); big_free(&r);
+    return failed;
+}
+
+/* The six-step layout is only taken from NTT_SIXSTEP_MIN points on, so
+   it is forced here with the threshold lowered, over power-of-two and
+   3 * 2^k lengths and one row or several, and must give the flat
+   transform's product. */
+static int selftest_sixstep(void) {
+    static const size_t sizes[][2] = { { 5000, 3000 }, { 20000, 30000 }, { 40000, 50000 }, { 300000, 250000 } };
+    int failed = 0;
+    Big a, b, z, r;
+    big_init(&a); big_init(&b); big_init(&z); big_init(&r);
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        selftest_random(&a, sizes[i][0]);
+        selftest_random(&b, sizes[i][1]);
+        if (i == 0) {
+            for (size_t k = 0; k < a.n; ++k) a.d[k] = 0xFFFFFFFFu;
+            for (size_t k = 0; k < b.n; ++k) b.d[k] = 0xFFFFFFFFu;
+        }
+        big_mul_ntt(&r, &a, &b);
+        ntt_sixstep_min = (size_t)1 << 13;
+        big_mul_ntt(&z, &a, &b);
+        ntt_sixstep_min = NTT_SIXSTEP_MIN;
+        size_t m = ntt_size(a.n + b.n - 1);
+        if (m & (m - 1)) m /= 3;
+        char what[64];
+        snprintf(what, sizeof(what), "six-step %zu x %zu limbs", a.n, b.n);
+        failed += selftest_report(what, big_cmp(&z, &r) == 0);
+        printf("    %zu x %zu matrix\n", ntt_local_rows(m), m / ntt_local_rows(m));
+    }
+    big_free(&a); big_free(&b); big_free(&z); big_free(&r);
+    return failed;
+}
+
+/* big_mul_to_sink over one transform, over one operand cut into blocks
+   against a short one, and over two blocks of a long pair must write the
+   limbs big_mul gives, padded to the sum of the operand lengths. */
+static int selftest_stream(void) {
+    static const size_t sizes[][2] = { { 5000, 3000 }, { 300, 200000 }, { 200000, 150000 } };
+    int failed = 0;
+    Big a, b, r;
+    big_init(&a); big_init(&b); big_init(&r);
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        selftest_random(&a, sizes[i][0]);
+        selftest_random(&b, sizes[i][1]);
+        big_mul(&r, &a, &b);
+        size_t rn = sizes[i][0] + sizes[i][1];
+        FILE* f = tmpfile();
+        int ok = f != NULL;
+        if (ok) {
+            BigSink sink;
+            big_sink_init(&sink, f);
+            ok = big_mul_to_sink(&a, &b, &sink) && sink.limbs == rn;
+            rewind(f);
+            for (size_t k = 0; ok && k < rn; ++k) {
+                unsigned char p[4];
+                ok = fread(p, 1, 4, f) == 4;
+                uint32_t limb = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+                ok = ok && limb == (k < r.n ? r.d[k] : 0);
+            }
+            fclose(f);
+        }
+        char what[64];
+        snprintf(what, sizeof(what), "stream %zu x %zu limbs", sizes[i][0], sizes[i][1]);
+        failed += selftest_report(what, ok);
+    }
+    big_free(&a); big_free(&b); big_free(&r);
+    return failed;
+}
+
+/* big_mul_step in 2 ms steps, over the schoolbook tier and over two NTT
+   blocks, must give the product big_mul gives; a budget below any unit
+   must be refused without work, and no step may spend more than the
+   budget and a quarter of CPU time. Wall time is reported too: on a
+   shared CPU it also holds whatever ran while the step was preempted. */
+static int selftest_step(void) {
+    static const size_t sizes[][2] = { { 300, 200 }, { 50000, 40000 }, { BIG_STEP_BLOCK + 1000, 1000 } };
+    int failed = 0;
+    Big a, b, r, z;
+    big_init(&a); big_init(&b); big_init(&r); big_init(&z);
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        selftest_random(&a, sizes[i][0]);
+        selftest_random(&b, sizes[i][1]);
+        big_mul(&r, &a, &b);
+        BigMulTask t;
+        big_mul_task_init(&t, &a, &b);
+        int ok = big_mul_step(&t, 1) == -1 && t.i == 0 && t.j == 0;
+        uint64_t budget = 2000000, worst = 0, wall = 0;
+        size_t steps = 0, over = 0, refused = 0, idle = 0;
+        int rc = 0;
+        while (ok && rc != 1) {
+            uint64_t t0 = big_now_ns(), c0 = big_cpu_ns();
+            rc = big_mul_step(&t, budget);
+            uint64_t d = big_cpu_ns() - c0, w = big_now_ns() - t0;
+            if (d > worst) worst = d;
+            if (w > wall) wall = w;
+            if (d > budget + budget / 4) ++over;
+            ++steps;
+            if (rc == -1) ++refused;
+            idle = rc == -1 ? idle + 1 : 0;
+            ok = idle < 1000;
+        }
+        big_mul_task_result(&t, &z);
+        big_mul_task_free(&t);
+        ok = ok && big_cmp(&z, &r) == 0;
+        char what[64];
+        snprintf(what, sizeof(what), "step %zu x %zu limbs", sizes[i][0], sizes[i][1]);
+        failed += selftest_report(what, ok && over == 0);
+        if (ok) printf("    %zu steps of 2 ms, %zu refused, slowest %.3f ms CPU (%.3f ms wall), %zu over budget\n",
+            steps, refused, (double)worst / 1e6, (double)wall / 1e6, over);
+    }
+    big_free(&a); big_free(&b); big_free(&r); big_free(&z);
+    return failed;
+}
+
+/* Mixed adds and multiply-adds through the carry-save accumulator against
+   big_add and big_mul, once as is and once with the slack cut so short
+   that carries are resolved before nearly every operation. */
+static int selftest_acc(void) {
+    int failed = 0;
+    Big x, y, t, sum, got;
+    big_init(&x); big_init(&y); big_init(&t); big_init(&sum); big_init(&got);
+    for (int tight = 0; tight < 2; ++tight) {
+        BigAcc acc;
+        big_acc_init(&acc);
+        big_zero(&sum);
+        for (int k = 0; k < 300; ++k) {
+            selftest_random(&x, 1 + (size_t)(selftest_next() % 300));
+            selftest_random(&y, 1 + (size_t)(selftest_next() % 300));
+            uint32_t m = (uint32_t)selftest_next();
+            switch (k % 3) {
+            case 0:
+                big_acc_add(&acc, &x);
+                big_copy(&t, &x);
+                break;
+            case 1:
+                big_acc_addmul_u32(&acc, &x, m);
+                big_from_u64(&y, m);
+                big_mul(&t, &x, &y);
+                break;
+            default:
+                big_acc_addmul(&acc, &x, &y);
+                big_mul(&t, &x, &y);
+                break;
+            }
+            big_add(&sum, &sum, &t);
+            if (tight && acc.slack > 8) acc.slack = 8;
+        }
+        big_acc_get(&acc, &got);
+        big_acc_free(&acc);
+        failed += selftest_report(tight ? "accumulator, tight slack" : "accumulator", big_cmp(&got, &sum) == 0);
+    }
+    big_free(&x); big_free(&y); big_free(&t); big_free(&sum); big_free(&got);
+    return failed;
+}
+
+/* z holds the int64 value v: sign and magnitude, zero never negative. */
+static int selftest_sbig_is(const SBig* z, int64_t v) {
+    uint64_t m;
+    return big_to_u64(&z->mag, &m) && z->neg == (v < 0) && m == (v < 0 ? 0 - (uint64_t)v : (uint64_t)v);
+}
+
+/* Signed add and sub over every sign combination: against int64
+   arithmetic for operands below 2^60, including equal magnitudes and
+   zero, and as (a + b) - b == a and a - a == +0 for multi-limb ones. */
+static int selftest_sbig(void) {
+    int ok = 1;
+    char buf[32];
+    SBig a, b, z, w;
+    sbig_init(&a); sbig_init(&b); sbig_init(&z); sbig_init(&w);
+    for (int k = 0; k < 1000 && ok; ++k) {
+        int64_t x = (int64_t)(selftest_next() >> 3) - ((int64_t)1 << 60);
+        int64_t y = k % 4 == 0 ? -x : k % 4 == 1 ? x : (int64_t)(selftest_next() >> 3) - ((int64_t)1 << 60);
+        if (k % 10 == 0) y = 0;
+        snprintf(buf, sizeof(buf), "%lld", (long long)x);
+        sbig_from_dec(&a, buf);
+        snprintf(buf, sizeof(buf), "%lld", (long long)y);
+        sbig_from_dec(&b, buf);
+        sbig_add(&z, &a, &b);
+        ok = selftest_sbig_is(&z, x + y);
+        sbig_sub(&z, &a, &b);
+        ok = ok && selftest_sbig_is(&z, x - y);
+    }
+    for (int k = 0; k < 100 && ok; ++k) {
+        selftest_random(&a.mag, 1 + (size_t)(selftest_next() % 200));
+        selftest_random(&b.mag, 1 + (size_t)(selftest_next() % 200));
+        a.neg = big_is_zero(&a.mag) ? 0 : k & 1;
+        b.neg = big_is_zero(&b.mag) ? 0 : (k >> 1) & 1;
+        sbig_add(&z, &a, &b);
+        sbig_sub(&w, &z, &b);
+        ok = w.neg == a.neg && big_cmp(&w.mag, &a.mag) == 0;
+        sbig_sub(&z, &a, &a);
+        ok = ok && !z.neg && big_is_zero(&z.mag);
+    }
+    sbig_free(&a); sbig_free(&b); sbig_free(&z); sbig_free(&w);
+    return selftest_report("signed add and sub", ok);
+}
+
+/* |x * 2^ex - y * 2^ey| is below the larger of the two times 2^-bits. */
+static int selftest_close(const Big* x, int64_t ex, const Big* y, int64_t ey, size_t bits) {
+    int64_t e = ex < ey ? ex : ey;
+    Big u, v, d;
+    big_init(&u); big_init(&v); big_init(&d);
+    big_shl(&u, x, (size_t)(ex - e) / 32, (unsigned)((ex - e) % 32));
+    big_shl(&v, y, (size_t)(ey - e) / 32, (unsigned)((ey - e) % 32));
+    int ge = big_cmp(&u, &v) >= 0;
+    big_sub(&d, ge ? &u : &v, ge ? &v : &u);
+    int ok = big_is_zero(&d) || big_bitlen(&d) + bits <= big_bitlen(ge ? &u : &v);
+    big_free(&u); big_free(&v); big_free(&d);
+    return ok;
+}
+
+/* BigFloat add, div and sqrt at 64 to 30000 bits, checked with exact
+   integer arithmetic: a + b against the aligned sum, (a / b) * b and
+   sqrt(a)^2 against a, each to all but the last few bits. */
+static int selftest_bf(void) {
+    static const size_t precs[] = { 64, 1000, 30000 };
+    int ok = 1;
+    Big m, s;
+    big_init(&m); big_init(&s);
+    for (size_t i = 0; i < sizeof(precs) / sizeof(precs[0]) && ok; ++i) {
+        size_t prec = precs[i];
+        BigFloat a, b, z;
+        bf_init(&a, prec); bf_init(&b, prec); bf_init(&z, prec);
+        for (int k = 0; k < 10 && ok; ++k) {
+            selftest_random(&m, (prec + 31) / 32);
+            bf_set_big(&a, &m, (int64_t)(selftest_next() % 401) - 200);
+            selftest_random(&m, (prec + 31) / 32);
+            bf_set_big(&b, &m, (int64_t)(selftest_next() % 401) - 200);
+
+            bf_add(&z, &a, &b);
+            int64_t e = a.exp < b.exp ? a.exp : b.exp;
+            Big x, y;
+            big_init(&x); big_init(&y);
+            big_shl(&x, &a.mant, (size_t)(a.exp - e) / 32, (unsigned)((a.exp - e) % 32));
+            big_shl(&y, &b.mant, (size_t)(b.exp - e) / 32, (unsigned)((b.exp - e) % 32));
+            big_add(&s, &x, &y);
+            big_free(&x); big_free(&y);
+            ok = selftest_close(&z.mant, z.exp, &s, e, prec - 2);
+
+            ok = ok && bf_div(&z, &a, &b);
+            big_mul(&s, &z.mant, &b.mant);
+            ok = ok && selftest_close(&s, z.exp + b.exp, &a.mant, a.exp, prec - 4);
+
+            bf_sqrt(&z, &a);
+            big_mul(&s, &z.mant, &z.mant);
+            ok = ok && selftest_close(&s, 2 * z.exp, &a.mant, a.exp, prec - 4);
+        }
+        big_zero(&b.mant);
+        b.exp = 0;
+        ok = ok && !bf_div(&z, &a, &b);
+        bf_free(&a); bf_free(&b); bf_free(&z);
+    }
+    big_free(&m); big_free(&s);
+    return selftest_report("float add, div and sqrt", ok);
+}
+
+/* big_to_double against the compiler's own rounding of random 64-bit
+   values, scaled past 2^64 by shifts, plus a tie that a bit far below
+   the kept 53 must round up and an overflow to infinity; sbig_from_i64
+   at the int64 limits. */
+static int selftest_convert(void) {
+    int ok = 1;
+    Big x, y, one;
+    big_init(&x); big_init(&y); big_init(&one);
+    for (int k = 0; k < 1000 && ok; ++k) {
+        uint64_t v = selftest_next() >> (k % 64);
+        unsigned sh = (unsigned)(selftest_next() % 300);
+        big_from_u64(&y, v);
+        big_shl(&x, &y, sh / 32, sh % 32);
+        ok = big_to_double(&x) == ldexp((double)v, (int)sh);
+    }
+    /* 2^53 + 1 sits halfway between two doubles and rounds to even. */
+    big_from_u64(&y, (1ull << 53) + 1);
+    big_shl(&x, &y, 1, 8);
+    ok = ok && big_to_double(&x) == ldexp(1.0, 53 + 40);
+    big_from_u64(&one, 1);
+    big_add(&x, &x, &one);
+    ok = ok && big_to_double(&x) == ldexp((double)((1ull << 53) + 2), 40);
+    big_shl(&x, &one, 40, 0);
+    ok = ok && big_to_double(&x) == HUGE_VAL;
+
+    static const int64_t ints[] = { 0, 1, -1, INT64_MAX, INT64_MIN, -4294967296ll };
+    SBig z;
+    sbig_init(&z);
+    for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]) && ok; ++i) {
+        sbig_from_i64(&z, ints[i]);
+        ok = selftest_sbig_is(&z, ints[i]);
+    }
+    sbig_free(&z);
+    big_free(&x); big_free(&y); big_free(&one);
+    return selftest_report("double and int64 conversion", ok);
+}
+
+/* Relaxed multiplication over 3000 limb pairs, enough for squares of
+   1024 limbs to go through the fast tiers: every limb it returns must be
+   final, i.e. equal that limb of the full product, and the closing result
+   must equal big_mul. */
+static int selftest_relaxed(void) {
+    size_t n = 3000;
+    Big a, b, r, z;
+    big_init(&a); big_init(&b); big_init(&r); big_init(&z);
+    selftest_random(&a, n);
+    selftest_random(&b, n);
+    a.d[n - 1] |= 1;
+    b.d[n - 1] |= 1;
+    a.n = b.n = n;
+    big_mul(&r, &a, &b);
+    BigRelaxed rx;
+    big_relaxed_init(&rx);
+    int ok = 1;
+    for (size_t i = 0; i < n && ok; ++i) ok = big_relaxed_push(&rx, a.d[i], b.d[i]) == r.d[i];
+    big_relaxed_result(&rx, &z);
+    ok = ok && big_cmp(&z, &r) == 0;
+    big_relaxed_free(&rx);
+    big_free(&a); big_free(&b); big_free(&r); big_free(&z);
+    return selftest_report("relaxed multiplication", ok);
+}
+
+static int run_selftest(void) {
+    int failed = selftest_fft();
+    failed += selftest_sixstep();
+    failed += selftest_stream();
+    failed += selftest_step();
+    failed += selftest_acc();
+    failed += selftest_sbig();
+    failed += selftest_bf();
+    failed += selftest_convert();
+    failed += selftest_relaxed();
+    if (failed) fprintf(stderr, "selftest: %d checks failed\n", failed);
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    char* a_str = NULL;
+    char* b_str = NULL;
+    size_t a_cap = 0, b_cap = 0;
+    int dec_out = 0;
+    const char* script = NULL;
+    const char* bin_out = NULL;
+    const char* batch = NULL;
+    double deadline_ms = 0;
+    const char* affinity = NULL;
+
+    big_ckpt.interval = BIG_CKPT_INTERVAL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--dec") == 0) dec_out = 1;
+        else if (strcmp(argv[i], "--hex") == 0) dec_out = 0;
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) big_cache_dir = argv[++i];
+        else if (strcmp(argv[i], "--memo") == 0 && i + 1 < argc) big_memo.limit = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) script = argv[++i];
+        else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) big_ckpt.path = argv[++i];
+        else if (strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc) big_ckpt.interval = (unsigned)strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--procs") == 0 && i + 1 < argc) ntt_shard_procs = (unsigned)strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--bin") == 0 && i + 1 < argc) bin_out = argv[++i];
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) batch = argv[++i];
+        else if (strcmp(argv[i], "--deadline") == 0 && i + 1 < argc) deadline_ms = strtod(argv[++i], NULL);
+        else if (strcmp(argv[i], "--learn") == 0) big_learn.on = 1;
+        else if (strcmp(argv[i], "--affinity") == 0 && i + 1 < argc) affinity = argv[++i];
+        else if (strcmp(argv[i], "--selftest") == 0) return run_selftest();
+        else {
+            fprintf(stderr, "Usage: %s [--hex | --dec] [--cache DIR] [--memo BYTES] [--script FILE]\n"
+                "       [--checkpoint FILE] [--checkpoint-every SEC] [--procs N] [--bin FILE]\n"
+                "       [--batch FILE] [--deadline MS] [--learn] [--affinity MODE] [--selftest]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (affinity && !big_affinity_plan(affinity)) {
+        fprintf(stderr, "Cannot place workers with --affinity %s.\n", affinity);
+        return 1;
+    }
+    if (big_learn.on) {
+        big_learn_load();
+        atexit(big_learn_save);
+    }
+
+    if (batch && bin_out) {
+        fprintf(stderr, "--bin works with --script or the prompts, not with --batch.\n");
+        return 1;
+    }
+    if (script || batch) {
+        int rc = script ? run_script(script, dec_out, bin_out) : run_batch(batch, dec_out, deadline_ms);
+        if (big_memo.limit) {
+            fflush(stdout);
+            big_memo_report(stderr);
+        }
+        return rc;
+    }
+
+    /* Prompts must not end up in a binary stream on stdout. */
+    FILE* prompt = (bin_out && strcmp(bin_out, "-") == 0) ? stderr : stdout;
+    fprintf(prompt, "Enter first (decimal) number: ");
+    fflush(prompt);
+    if (!script_read_line(stdin, &a_str, &a_cap)) {
+        fprintf(stderr, "Input error.\n");
+        free(a_str);
+        return 1;
+    }
+
+    fprintf(prompt, "Enter second (decimal) number: ");
+    fflush(prompt);
+    if (!script_read_line(stdin, &b_str, &b_cap)) {
+        fprintf(stderr, "Input error.\n");
+        free(a_str); free(b_str);
+        return 1;
+    }
+
+    if (bin_out || dec_out) {
+        int rc = bin_out ? run_bin_job(a_str, b_str, bin_out) : run_dec_job(a_str, b_str);
+        free(a_str); free(b_str);
+        return rc;
+    }
+
+    SBig A, B, C;
+    sbig_init(&A); sbig_init(&B); sbig_init(&C);
+
+    int parsed = sbig_from_dec(&A, a_str) && sbig_from_dec(&B, b_str);
+    free(a_str); free(b_str);
+    if (!parsed) {
+        fprintf(stderr, "Invalid input. Please enter decimal digits only.\n");
+        sbig_free(&A); sbig_free(&B); sbig_free(&C);
+        return 1;
+    }
+
+    if (deadline_ms > 0) {
+        uint64_t est;
+        if (!big_mul_deadline(&C.mag, &A.mag, &B.mag, (uint64_t)(deadline_ms * 1e6), NULL, &est)) {
+            fprintf(stderr, "Deadline of %.3f ms cannot be met (estimated %.3f ms).\n", deadline_ms, (double)est / 1e6);
+            sbig_free(&A); sbig_free(&B); sbig_free(&C);
+            return 1;
+        }
+        C.neg = big_is_zero(&C.mag) ? 0 : A.neg ^ B.neg;
+    } else {
+        sbig_mul(&C, &A, &B);
+    }
+
+    printf("Result (hex): ");
+    sbig_print_hex(&C);
+    if (big_memo.limit) {
+        fflush(stdout);
+        big_memo_report(stderr);
+    }
 
-    big_free(&A); big_free(&B); big_free(&C);
+    sbig_free(&A); sbig_free(&B); sbig_free(&C);
     return 0;
 }
@@ -0,0 +1,41 @@
+#!/bin/sh
+# Kill/resume test for --checkpoint (POSIX). Kills a script run with
+# SIGKILL as soon as its first checkpoint is on disk, runs it again and
+# checks that the rerun resumes, prints the same result as a run without
+# checkpoints and removes the checkpoint file when done.
+set -e
+cd "$(dirname "$0")/.."
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+cc -O2 -o "$work/bignum" BigNum/BigNum/BigNum.c -lm -lpthread
+printf 'x = 7^12000000\ny = x*x\ny mod 1000000007\n' > "$work/job.txt"
+"$work/bignum" --script "$work/job.txt" > "$work/expected"
+
+"$work/bignum" --script "$work/job.txt" --checkpoint "$work/ck.bin" --checkpoint-every 0 > /dev/null &
+pid=$!
+while [ ! -f "$work/ck.bin" ]; do
+    if ! kill -0 "$pid" 2>/dev/null; then
+        echo "FAIL: the run finished without writing a checkpoint"
+        exit 1
+    fi
+    sleep 0.01
+done
+kill -9 "$pid" 2>/dev/null || true
+wait "$pid" 2>/dev/null || true
+
+"$work/bignum" --script "$work/job.txt" --checkpoint "$work/ck.bin" --checkpoint-every 0 \
+    > "$work/got" 2> "$work/err"
+if ! grep -q "resuming" "$work/err"; then
+    echo "FAIL: the rerun did not resume from the checkpoint"
+    exit 1
+fi
+if ! cmp -s "$work/expected" "$work/got"; then
+    echo "FAIL: the resumed result differs"
+    exit 1
+fi
+if [ -e "$work/ck.bin" ]; then
+    echo "FAIL: the checkpoint was left behind"
+    exit 1
+fi
+echo "PASS: checkpoint resume"
@@ -0,0 +1,41 @@
+#!/bin/sh
+# Builds the program warning-free and runs its --selftest checks (POSIX).
+# The vector NTT and FFT kernels are compiled only for AVX2 or AVX-512
+# targets, so those builds are checked too where this CPU can run them.
+set -e
+cd "$(dirname "$0")/.."
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+check() {
+    cc -O2 -Wall -Wextra -Werror $2 -o "$work/bignum" BigNum/BigNum/BigNum.c -lm -lpthread
+    if ! "$work/bignum" --selftest; then
+        echo "FAIL: selftest ($1)"
+        exit 1
+    fi
+}
+
+check scalar ""
+
+cat > "$work/cpu.c" <<'EOF'
+#include <string.h>
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "avx512f") == 0) return !__builtin_cpu_supports("avx512f");
+    return !(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"));
+}
+EOF
+if cc -o "$work/cpu" "$work/cpu.c" 2>/dev/null; then
+    if "$work/cpu" avx2; then
+        check avx2 "-mavx2 -mfma"
+    else
+        echo "skip: no AVX2 on this CPU"
+    fi
+    if "$work/cpu" avx512f; then
+        check avx512f "-mavx512f -mavx2 -mfma"
+    else
+        echo "skip: no AVX-512 on this CPU"
+    fi
+else
+    echo "skip: vector builds need __builtin_cpu_supports"
+fi
+echo "PASS: selftest"